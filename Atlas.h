@@ -149,6 +149,9 @@ static inline const char* GetGLErrorString( GLenum error ){
 #if UINT_MAX != 4294967295
 #error bad int size
 #endif
+#if USHRT_MAX != 65535
+#error bad short size
+#endif
 #if UCHAR_MAX != 255
 #error bad char size
 #endif
@@ -157,6 +160,7 @@ typedef unsigned long long int u64;
 typedef signed long long int s64;
 typedef unsigned int u32;
 typedef signed int s32;
+typedef unsigned short u16;
 typedef unsigned char u8;
 typedef signed char s8;
 typedef float f32;
@@ -174,20 +178,63 @@ extern bool additive;
 ////////////////////////////////////////////////////////////////////
 // Memory instrumentation
 
+#include "memprofile.h"
+
 #ifdef DEBUG
 
+// Allocations are tracked in an open addressed table keyed by pointer, with a
+// power of 2 capacity. Freed entries stay in place so double frees can be
+// reported with their allocation site, until the table is rebuilt to grow.
 typedef struct MemAlloc{
-  void* ptr;
+  void* ptr;  // NULL for an empty slot.
   size_t size;
   const char* file;
   int line;
   int freed;  // Indicates if the memory has been freed
-  struct MemAlloc* next;
 } MemAlloc;
 
-extern MemAlloc* mem_list;
+extern MemAlloc* mem_table;
+extern size_t mem_table_capacity;
+extern size_t mem_table_used;  // Slots holding an entry, freed or not.
+extern size_t mem_table_live;
 extern SDL_mutex* mem_list_mutex;  // Use SDL mutex
 
+static inline size_t mem_hash( const void* ptr ){
+  u64 h = (u64)(uintptr_t)ptr * 11400714819323198485ull;
+  return (size_t)( h ^ ( h >> 29 ) );
+}
+
+// Returns the slot holding ptr, or the empty slot where it would go.
+static inline MemAlloc* mem_find( const void* ptr ){
+  size_t mask = mem_table_capacity - 1;
+  size_t i = mem_hash( ptr ) & mask;
+  while( mem_table[ i ].ptr && mem_table[ i ].ptr != ptr )
+    i = ( i + 1 ) & mask;
+  return mem_table + i;
+}
+
+// Rebuilds the table with room for the live entries, dropping freed ones.
+static inline void mem_rebuild( void ){
+  MemAlloc* old = mem_table;
+  size_t oldCapacity = mem_table_capacity;
+  size_t capacity = 1024;
+  while( capacity < mem_table_live * 4 )
+    capacity *= 2;
+  mem_table = calloc( capacity, sizeof( MemAlloc ) );
+  if( !mem_table ){
+    fprintf( stderr, "Failed to allocate memory for tracking\n" );
+    exit( EXIT_FAILURE );
+  }
+  mem_table_capacity = capacity;
+  mem_table_used = 0;
+  for( size_t i = 0; i < oldCapacity; ++i )
+    if( old[ i ].ptr && !old[ i ].freed ){
+      *mem_find( old[ i ].ptr ) = old[ i ];
+      ++mem_table_used;
+    }
+  free( old );
+}
+
 static inline void*
 mem_track( size_t count, size_t size, const char* file, int line ){
   // Initialize the mutex if it's not already initialized
@@ -204,22 +251,22 @@ mem_track( size_t count, size_t size, const char* file, int line ){
     fprintf( stderr, "Memory allocation failed at %s:%d\n", file, line );
     exit( EXIT_FAILURE );
   }
-  MemAlloc* alloc = calloc( 1, sizeof( MemAlloc ) );
-  if( !alloc ){
-    fprintf(
-      stderr, "Failed to allocate memory for tracking at %s:%d\n", file, line );
-    free( ptr );
-    exit( EXIT_FAILURE );
-  }
+  if( memProfiling )
+    memProfileAlloc( count * size, file, line );
+
+  SDL_LockMutex( mem_list_mutex );
+  if( ( mem_table_used + 1 ) * 2 > mem_table_capacity )
+    mem_rebuild();
+  MemAlloc* alloc = mem_find( ptr );
+  // A freed entry for a reused address is simply overwritten.
+  if( !alloc->ptr )
+    ++mem_table_used;
   alloc->ptr = ptr;
   alloc->size = count * size;
   alloc->file = file;
   alloc->line = line;
   alloc->freed = 0;  // Set freed flag to 0
-
-  SDL_LockMutex( mem_list_mutex );
-  alloc->next = mem_list;
-  mem_list = alloc;
+  ++mem_table_live;
   SDL_UnlockMutex( mem_list_mutex );
 
   return ptr;
@@ -240,27 +287,25 @@ static inline void unmem_track( void* ptr, const char* file, int line ){
   }
 
   SDL_LockMutex( mem_list_mutex );
-  MemAlloc* current = mem_list;
-  while( current ){
-    if( current->ptr == ptr ){
-      if( current->freed ){
-        // Double free detected
-        fprintf(
-          stderr,
-          "Double free detected at %s:%d (originally allocated at %s:%d)\n",
-          file,
-          line,
-          current->file,
-          current->line );
-      } else {
-        // Mark as freed and free the memory
-        current->freed = 1;
-        free( ptr );
-      }
-      SDL_UnlockMutex( mem_list_mutex );
-      return;
+  MemAlloc* current = mem_table ? mem_find( ptr ) : NULL;
+  if( current && current->ptr ){
+    if( current->freed ){
+      // Double free detected
+      fprintf(
+        stderr,
+        "Double free detected at %s:%d (originally allocated at %s:%d)\n",
+        file,
+        line,
+        current->file,
+        current->line );
+    } else {
+      // Mark as freed and free the memory
+      current->freed = 1;
+      --mem_table_live;
+      free( ptr );
     }
-    current = current->next;
+    SDL_UnlockMutex( mem_list_mutex );
+    return;
   }
   SDL_UnlockMutex( mem_list_mutex );
   fprintf( stderr,
@@ -273,10 +318,10 @@ static inline void check_memory_leaks( void ){
   if( mem_list_mutex ){
     SDL_LockMutex( mem_list_mutex );
   }
-  MemAlloc* current = mem_list;
   int leaks_found = 0;
-  while( current ){
-    if( !current->freed ){
+  for( size_t i = 0; i < mem_table_capacity; ++i ){
+    MemAlloc* current = mem_table + i;
+    if( current->ptr && !current->freed ){
       fprintf( stderr,
                "Memory leak of %zu bytes allocated at %s:%d\n",
                current->size,
@@ -284,11 +329,10 @@ static inline void check_memory_leaks( void ){
                current->line );
       leaks_found = 1;
     }
-    MemAlloc* to_free = current;
-    current = current->next;
-    free( to_free );  // Free the tracking struct itself
   }
-  mem_list = NULL;
+  free( mem_table );  // Free the tracking table itself
+  mem_table = NULL;
+  mem_table_capacity = mem_table_used = mem_table_live = 0;
   if( mem_list_mutex ){
     SDL_UnlockMutex( mem_list_mutex );
     SDL_DestroyMutex( mem_list_mutex );
@@ -310,6 +354,8 @@ extern u64 memc;
 
 static inline void* mem_check(void* ptr, size_t bytes, const char* file, int line) {
     memc++;
+    if (memProfiling)
+        memProfileAlloc(bytes, file, line);
     if (!ptr) {
         printf("OOM: %zu bytes at %s:%d\n", bytes, file, line);
         exit(1);
@@ -343,13 +389,15 @@ static inline void* mem_check(void* ptr, size_t bytes, const char* file, int lin
 
 float getMaxAnisotropy( void );
 
-// Globals
+// Globals, defined in globals.c unless noted.
+#define TEXTBUFFERSIZE 1048576
 extern char* textBuffer;
 extern u64 textBufferPos;
+#define TEXTINPUTBUFFERSIZE 1048576
 extern char* textInputBuffer;
 extern u64 textInputBufferPos;
 extern SDL_Window* window;
-extern SDL_GLContext glContext;
+extern SDL_GLContext glContext; // main.c
 extern f32 mouseWheel;
 extern f32 mouseWheelPos;
 extern u32 buttons;
@@ -360,18 +408,28 @@ extern float pinchZoom;
 extern u8 keys[ SDL_NUM_SCANCODES ];
 extern f64 timeDelta;
 extern f64 runTime;
-extern GLuint vao;
+extern GLuint vao; // main.c
 #define MAX_CONTROLLERS 8
 extern SDL_GameController* controllers[ MAX_CONTROLLERS ];
-extern SDL_JoystickID joystickIDs[ MAX_CONTROLLERS ];
+extern SDL_JoystickID joystickIDs[ MAX_CONTROLLERS ]; // main.c
 extern f32 joysticks[ MAX_CONTROLLERS * 21 ];
 extern u32 fullscreen;  // 0 not fullscreen, 1 trying to get full screen, 2 already fullscreen.
 
 #include "tensor.h"
 #include "program.h"
 #include "trie.h"
-
+#include "bench.h"
+#include "profile.h"
+#include "trace.h"
+#include "glstats.h"
+#include "replay.h"
+#include "pool.h"
+#include "shadercache.h"
+
+FILE* openFile( const char* filename, const char* mode );
 bool fileExists( const char* filename );
+// print also echoes to stdout, or to stderr if printToStderr is set.
+extern bool printToStderr;
 void print( const char* format, ... );
 void printToBuffer( const char* format, ... );
 char* printToString( const char* format, ... );
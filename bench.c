@@ -0,0 +1,133 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright © 2025 Jon DuBois. Written with the assistance of GPT-4 et al.   //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Atlas.h"
+
+bool benchmarking = false;
+
+static char* benchFile = NULL;
+static char* benchScript = NULL;
+static f64 benchDelta = 0.0;
+static benchFrame* benchFrames = NULL;
+static u32 benchCount = 0;
+static u32 benchSize = 0;
+
+void benchStart( const char* outFile, const char* script, u32 frames, f64 delta ){
+  benchFile = printToString( "%s", outFile );
+  benchScript = printToString( "%s", script ? script : "main.atl" );
+  benchDelta = delta;
+  benchSize = frames;
+  benchCount = 0;
+  benchFrames = mem( frames, benchFrame );
+  benchmarking = true;
+  gpuProfiling = true;
+}
+
+void benchRecord( const benchFrame* frame ){
+  if( benchCount < benchSize )
+    benchFrames[ benchCount++ ] = *frame;
+}
+
+// Net allocation count. DEBUG builds track allocations individually instead
+// of keeping memc, so there is nothing cheap to report.
+s64 benchMemCount( void ){
+#ifdef DEBUG
+  return 0;
+#else
+  return memc;
+#endif
+}
+
+// Writes a string with JSON escaping, script paths may contain backslashes.
+void benchWriteString( FILE* f, const char* str ){
+  fputc( '"', f );
+  for( const char* c = str; *c; ++c ){
+    if( *c == '"' || *c == '\\' )
+      fputc( '\\', f );
+    fputc( *c, f );
+  }
+  fputc( '"', f );
+}
+
+static int compareF64( const void* a, const void* b ){
+  f64 x = *(const f64*)a;
+  f64 y = *(const f64*)b;
+  return ( x > y ) - ( x < y );
+}
+
+// Nearest rank percentile of a sorted array.
+static f64 percentile( const f64* sorted, u32 count, f64 p ){
+  if( !count )
+    return 0.0;
+  u32 rank = ceil( p * count );
+  if( rank < 1 )
+    rank = 1;
+  return sorted[ rank - 1 ];
+}
+
+// Writes ,"name": { mean, p50, p95, p99, max } in milliseconds for one field
+// of benchFrame, selected by its byte offset.
+static void writeStats( FILE* f, const char* name, u64 fieldOffset, f64* scratch ){
+  f64 sum = 0.0;
+  for( u32 i = 0; i < benchCount; ++i ){
+    scratch[ i ] = *(const f64*)( (const u8*)( benchFrames + i ) + fieldOffset ) * 1000.0;
+    sum += scratch[ i ];
+  }
+  qsort( scratch, benchCount, sizeof( f64 ), compareF64 );
+  fprintf( f,
+           ",\n  \"%s\": { \"mean\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f }",
+           name,
+           benchCount ? sum / benchCount : 0.0,
+           percentile( scratch, benchCount, 0.50 ),
+           percentile( scratch, benchCount, 0.95 ),
+           percentile( scratch, benchCount, 0.99 ),
+           benchCount ? scratch[ benchCount - 1 ] : 0.0 );
+}
+
+void benchFinish( void ){
+  if( !benchmarking )
+    return;
+  benchmarking = false;
+  FILE* f = strcmp( benchFile, "-" ) ? fopen( benchFile, "w" ) : stdout;
+  if( !f )
+    error( "Failed to open benchmark output file %s.", benchFile );
+
+  f64* scratch = mem( benchCount + 1, f64 );
+  fprintf( f, "{\n" );
+  fprintf( f, "  \"script\": " );
+  benchWriteString( f, benchScript );
+  fprintf( f, ",\n  \"frames\": %u", benchCount );
+  fprintf( f, ",\n  \"timeDelta\": %.6f", benchDelta );
+  writeStats( f, "frameMs", offsetof( benchFrame, frame ), scratch );
+  writeStats( f, "runProgramMs", offsetof( benchFrame, run ), scratch );
+  writeStats( f, "presentMs", offsetof( benchFrame, present ), scratch );
+#ifndef DEBUG
+  s64 memTotal = 0, memMax = 0;
+  for( u32 i = 0; i < benchCount; ++i ){
+    memTotal += benchFrames[ i ].memDelta;
+    if( benchFrames[ i ].memDelta > memMax )
+      memMax = benchFrames[ i ].memDelta;
+  }
+  fprintf( f,
+           ",\n  \"memcDelta\": { \"mean\": %.4f, \"max\": %lld, \"total\": %lld }",
+           benchCount ? (f64)memTotal / benchCount : 0.0,
+           memMax,
+           memTotal );
+#endif
+#ifdef GL_STATS
+  glStatsWriteJson( f );
+#endif
+  gpuProfileCollect( true );
+  gpuProfileWriteJson( f, benchCount );
+  fprintf( f, "\n}\n" );
+  unmem( scratch );
+
+  if( f != stdout )
+    fclose( f );
+  unmem( benchFrames );
+  unmem( benchFile );
+  unmem( benchScript );
+  benchFrames = NULL;
+  benchFile = benchScript = NULL;
+}
@@ -0,0 +1,26 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright © 2025 Jon DuBois. Written with the assistance of GPT-4 et al.   //
+////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef BENCH_H_INCLUDED
+#define BENCH_H_INCLUDED
+
+// Frame benchmark. When enabled with --bench, the render loop records the
+// timings of every frame and the results are written out as JSON on exit.
+typedef struct{
+  f64 frame;    // Seconds from the start of the frame to after the swap.
+  f64 run;      // Seconds inside runProgram.
+  f64 present;  // Seconds in the present pass, including the swap.
+  s64 memDelta; // Net change in memc over the frame.
+} benchFrame;
+
+extern bool benchmarking;
+
+void benchStart( const char* outFile, const char* script, u32 frames, f64 delta );
+void benchRecord( const benchFrame* frame );
+void benchFinish( void );
+s64 benchMemCount( void );
+void benchWriteString( FILE* f, const char* str );
+
+#endif //BENCH_H_INCLUDED
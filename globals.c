@@ -0,0 +1,124 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright © 2025 Jon DuBois. Written with the assistance of GPT-4 et al.   //
+////////////////////////////////////////////////////////////////////////////////
+
+// Globals and helpers the engine expects its entry point to provide, shared by
+// main.c and kernelbench.c.
+
+#include "Atlas.h"
+
+#ifdef DEBUG
+MemAlloc* mem_table = NULL;
+size_t mem_table_capacity = 0;
+size_t mem_table_used = 0;
+size_t mem_table_live = 0;
+SDL_mutex* mem_list_mutex = NULL;  // Use SDL mutex
+#else
+u64 memc = 0;
+#endif
+
+bool depthTest = false;
+bool additive = false;
+SDL_GameController* controllers[ MAX_CONTROLLERS ] = { NULL };
+f32 joysticks[ MAX_CONTROLLERS * 21 ] = { 0 };
+u32 buttons = 0;
+f32 dx = 0;
+f32 dy = 0;
+f32 posx = 0;
+f32 posy = 0;
+f32 mouseWheel = 0;
+f32 mouseWheelPos = 0.0;
+u8 keys[ SDL_NUM_SCANCODES ] = { 0 };
+// We set this in main to a mallocd empty string then also deallocate it in
+// main.
+char* workspace = NULL;
+
+bool doubleClicks[ 3 ] = { 0 };
+bool touchClicks[ 3 ] = { 0 };
+float pinchZoom = 0.0;
+
+SDL_Window* window = NULL;
+f64 runTime = 0.0;
+f64 timeDelta = 0.01;
+char* textInputBuffer = NULL;
+u64 textInputBufferPos = 0;
+char* textBuffer = NULL;
+u64 textBufferPos = 0;
+u32 fullscreen = 0; // 0 no, 1, maybe, 2, yes
+bool printToStderr = false;
+
+float getMaxAnisotropy( void ){
+  static float ret = 0.0;
+  if( ret )
+    return ret;
+  // Check if the anisotropic filtering extension is supported
+  const char* extensions = (const char*)glGetString( GL_EXTENSIONS );
+  if( extensions && strstr( extensions, "EXT_texture_filter_anisotropic" ) ){
+    // Retrieve the extension
+    GLfloat maxAnisotropy = 1.0f;
+    glGetFloatv( GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &maxAnisotropy );
+    ret = maxAnisotropy;
+  } else {
+    ret = 1.0f;  // Default value (no anisotropic filtering)
+  }
+  return ret;
+}
+void vPrintToBuffer( const char* format, va_list args ){
+  va_list len_args;
+  va_copy( len_args, args );
+  int needed = vsnprintf( NULL, 0, format, len_args );
+  va_end( len_args );
+
+  if( needed < 0 || !textBuffer ) return;
+
+  int available = TEXTBUFFERSIZE - textBufferPos - 1;
+  if( needed > available ){
+    size_t discard_amount = textBufferPos / 2;
+    if( needed > (int)( TEXTBUFFERSIZE - ( textBufferPos - discard_amount ) ) ){
+      size_t keep = ( TEXTBUFFERSIZE - 1 ) - needed;
+      if( keep > textBufferPos ) keep = 0;
+      discard_amount = textBufferPos - keep;
+    }
+    memmove( textBuffer, textBuffer + discard_amount, textBufferPos - discard_amount );
+    textBufferPos -= discard_amount;
+  }
+  vsnprintf( textBuffer + textBufferPos, TEXTBUFFERSIZE - textBufferPos, format, args );
+  
+  textBufferPos += needed;
+  if( textBufferPos >= TEXTBUFFERSIZE ) textBufferPos = TEXTBUFFERSIZE - 1;
+  textBuffer[ textBufferPos ] = '\0';
+}
+
+void printToBuffer( const char* format, ... ){
+  va_list args;
+  va_start( args, format );
+  vPrintToBuffer( format, args );
+  va_end( args );
+}
+
+void print( const char* format, ... ){
+  va_list args;
+  va_start( args, format );
+  va_list stdout_args;
+  va_copy( stdout_args, args );
+  vfprintf( printToStderr ? stderr : stdout, format, stdout_args );
+  va_end( stdout_args );
+  vPrintToBuffer( format, args );
+  va_end( args );
+}
+char* printToString( const char* format, ... ){
+  va_list args;
+  va_start( args, format );
+  va_list args_copy;
+  va_copy( args_copy, args );
+  int needed = vsnprintf( NULL, 0, format, args_copy );
+  va_end( args_copy );
+  if( needed < 0 ){
+    va_end( args );
+    return NULL; 
+  }
+  char* str = mem( needed + 1, char );
+  vsnprintf( str, needed + 1, format, args );
+  va_end( args );
+  return str;
+}
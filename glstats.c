@@ -0,0 +1,55 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright © 2025 Jon DuBois. Written with the assistance of GPT-4 et al.   //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Atlas.h"
+
+// In the order of the fields of glCounters.
+const char* glStatsNames[] = {
+  "draws", "programBinds", "textureBinds", "framebufferBinds", "texParameters",
+  "uniforms", "texturesCreated", "texturesDeleted", "framebuffersCreated",
+  "framebuffersDeleted", "renderbuffersCreated", "renderbuffersDeleted",
+  "bytesUploaded", "bytesRead"
+};
+
+glCounters glStats = { 0 };
+glCounters glStatsLast = { 0 };
+glCounters glStatsTotal = { 0 };
+u32 glStatsFrames = 0;
+
+void glStatsFrame( void ){
+  u64* cur = (u64*)&glStats;
+  u64* total = (u64*)&glStatsTotal;
+  for( u32 i = 0; i < GLSTATS_COUNT; ++i )
+    total[ i ] += cur[ i ];
+  glStatsLast = glStats;
+  memset( &glStats, 0, sizeof( glStats ) );
+  ++glStatsFrames;
+}
+
+u64 glStatsPixelBytes( GLenum format, GLenum type, GLsizei width, GLsizei height, GLsizei depth ){
+  u64 components, size;
+  switch( format ){
+  case GL_RED: components = 1; break;
+  case GL_RG: components = 2; break;
+  case GL_RGB: components = 3; break;
+  case GL_RGBA: components = 4; break;
+  default: return 0;
+  }
+  switch( type ){
+  case GL_UNSIGNED_BYTE: size = 1; break;
+  case GL_HALF_FLOAT: size = 2; break;
+  case GL_FLOAT: size = 4; break;
+  default: return 0;
+  }
+  return components * size * (u64)width * (u64)height * (u64)depth;
+}
+
+void glStatsWriteJson( FILE* f ){
+  const u64* total = (const u64*)&glStatsTotal;
+  fprintf( f, ",\n  \"glCallsPerFrame\": {" );
+  for( u32 i = 0; i < GLSTATS_COUNT; ++i )
+    fprintf( f, "%s \"%s\": %.2f", i ? "," : "", glStatsNames[ i ],
+             glStatsFrames ? (f64)total[ i ] / glStatsFrames : 0.0 );
+  fprintf( f, " }" );
+}
@@ -0,0 +1,221 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright © 2025 Jon DuBois. Written with the assistance of GPT-4 et al.   //
+////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef GLSTATS_H_INCLUDED
+#define GLSTATS_H_INCLUDED
+
+// GL call accounting. Built with GL_STATS defined (make glstats), the GL entry
+// points below are replaced by wrappers that count calls and bytes moved, per
+// frame. Without it the counters stay zero and the GL calls are untouched.
+typedef struct{
+  u64 draws;
+  u64 programBinds;
+  u64 textureBinds;
+  u64 framebufferBinds;
+  u64 texParameters;
+  u64 uniforms;
+  u64 texturesCreated;
+  u64 texturesDeleted;
+  u64 framebuffersCreated;
+  u64 framebuffersDeleted;
+  u64 renderbuffersCreated;
+  u64 renderbuffersDeleted;
+  u64 bytesUploaded;
+  u64 bytesRead;
+} glCounters;
+#define GLSTATS_COUNT ( sizeof( glCounters ) / sizeof( u64 ) )
+
+extern const char* glStatsNames[];
+extern glCounters glStats;      // The frame in progress.
+extern glCounters glStatsLast;  // The last complete frame.
+extern glCounters glStatsTotal; // Every complete frame since startup.
+extern u32 glStatsFrames;
+
+// Ends the frame in progress, called once per frame by the render loop.
+void glStatsFrame( void );
+// The size of a pixel transfer, or 0 if the format or type is unknown.
+u64 glStatsPixelBytes( GLenum format, GLenum type, GLsizei width, GLsizei height, GLsizei depth );
+// Writes the per-frame means of glStatsTotal as a JSON object field.
+void glStatsWriteJson( FILE* f );
+
+
+#ifdef GL_STATS
+// Each wrapper calls the entry point as it was defined before this header, be
+// it a function or a GLEW pointer, then the name is redirected to the wrapper.
+static inline void glStatsDrawArrays( GLenum mode, GLint first, GLsizei count ){
+  ++glStats.draws;
+  glDrawArrays( mode, first, count );
+}
+static inline void glStatsUseProgram( GLuint program ){
+  ++glStats.programBinds;
+  glUseProgram( program );
+}
+static inline void glStatsBindTexture( GLenum target, GLuint texture ){
+  ++glStats.textureBinds;
+  glBindTexture( target, texture );
+}
+static inline void glStatsBindFramebuffer( GLenum target, GLuint framebuffer ){
+  ++glStats.framebufferBinds;
+  glBindFramebuffer( target, framebuffer );
+}
+static inline void glStatsTexParameteri( GLenum target, GLenum pname, GLint param ){
+  ++glStats.texParameters;
+  glTexParameteri( target, pname, param );
+}
+static inline void glStatsTexParameterf( GLenum target, GLenum pname, GLfloat param ){
+  ++glStats.texParameters;
+  glTexParameterf( target, pname, param );
+}
+static inline void glStatsUniform1i( GLint l, GLint x ){
+  ++glStats.uniforms;
+  glUniform1i( l, x );
+}
+static inline void glStatsUniform2i( GLint l, GLint x, GLint y ){
+  ++glStats.uniforms;
+  glUniform2i( l, x, y );
+}
+static inline void glStatsUniform4i( GLint l, GLint x, GLint y, GLint z, GLint w ){
+  ++glStats.uniforms;
+  glUniform4i( l, x, y, z, w );
+}
+static inline void glStatsUniform1f( GLint l, GLfloat x ){
+  ++glStats.uniforms;
+  glUniform1f( l, x );
+}
+static inline void glStatsUniform2f( GLint l, GLfloat x, GLfloat y ){
+  ++glStats.uniforms;
+  glUniform2f( l, x, y );
+}
+static inline void glStatsUniform4f( GLint l, GLfloat x, GLfloat y, GLfloat z, GLfloat w ){
+  ++glStats.uniforms;
+  glUniform4f( l, x, y, z, w );
+}
+static inline void glStatsUniform1fv( GLint l, GLsizei n, const GLfloat* v ){
+  ++glStats.uniforms;
+  glUniform1fv( l, n, v );
+}
+static inline void glStatsUniform2fv( GLint l, GLsizei n, const GLfloat* v ){
+  ++glStats.uniforms;
+  glUniform2fv( l, n, v );
+}
+static inline void glStatsUniform3fv( GLint l, GLsizei n, const GLfloat* v ){
+  ++glStats.uniforms;
+  glUniform3fv( l, n, v );
+}
+static inline void glStatsUniform4fv( GLint l, GLsizei n, const GLfloat* v ){
+  ++glStats.uniforms;
+  glUniform4fv( l, n, v );
+}
+static inline void glStatsUniformMatrix4fv( GLint l, GLsizei n, GLboolean t, const GLfloat* v ){
+  ++glStats.uniforms;
+  glUniformMatrix4fv( l, n, t, v );
+}
+static inline void glStatsGenTextures( GLsizei n, GLuint* textures ){
+  glStats.texturesCreated += n;
+  glGenTextures( n, textures );
+}
+static inline void glStatsDeleteTextures( GLsizei n, const GLuint* textures ){
+  glStats.texturesDeleted += n;
+  glDeleteTextures( n, textures );
+}
+static inline void glStatsGenFramebuffers( GLsizei n, GLuint* framebuffers ){
+  glStats.framebuffersCreated += n;
+  glGenFramebuffers( n, framebuffers );
+}
+static inline void glStatsDeleteFramebuffers( GLsizei n, const GLuint* framebuffers ){
+  glStats.framebuffersDeleted += n;
+  glDeleteFramebuffers( n, framebuffers );
+}
+static inline void glStatsGenRenderbuffers( GLsizei n, GLuint* renderbuffers ){
+  glStats.renderbuffersCreated += n;
+  glGenRenderbuffers( n, renderbuffers );
+}
+static inline void glStatsDeleteRenderbuffers( GLsizei n, const GLuint* renderbuffers ){
+  glStats.renderbuffersDeleted += n;
+  glDeleteRenderbuffers( n, renderbuffers );
+}
+static inline void glStatsTexImage3D( GLenum target, GLint level, GLint internalFormat,
+                                      GLsizei width, GLsizei height, GLsizei depth,
+                                      GLint border, GLenum format, GLenum type,
+                                      const void* data ){
+  if( data )
+    glStats.bytesUploaded += glStatsPixelBytes( format, type, width, height, depth );
+  glTexImage3D( target, level, internalFormat, width, height, depth, border, format, type, data );
+}
+static inline void glStatsTexSubImage3D( GLenum target, GLint level,
+                                         GLint x, GLint y, GLint z,
+                                         GLsizei width, GLsizei height, GLsizei depth,
+                                         GLenum format, GLenum type, const void* data ){
+  glStats.bytesUploaded += glStatsPixelBytes( format, type, width, height, depth );
+  glTexSubImage3D( target, level, x, y, z, width, height, depth, format, type, data );
+}
+static inline void glStatsBufferData( GLenum target, GLsizeiptr size, const void* data, GLenum usage ){
+  if( data )
+    glStats.bytesUploaded += size;
+  glBufferData( target, size, data, usage );
+}
+static inline void glStatsReadPixels( GLint x, GLint y, GLsizei width, GLsizei height,
+                                      GLenum format, GLenum type, void* data ){
+  glStats.bytesRead += glStatsPixelBytes( format, type, width, height, 1 );
+  glReadPixels( x, y, width, height, format, type, data );
+}
+
+#undef glDrawArrays
+#define glDrawArrays glStatsDrawArrays
+#undef glUseProgram
+#define glUseProgram glStatsUseProgram
+#undef glBindTexture
+#define glBindTexture glStatsBindTexture
+#undef glBindFramebuffer
+#define glBindFramebuffer glStatsBindFramebuffer
+#undef glTexParameteri
+#define glTexParameteri glStatsTexParameteri
+#undef glTexParameterf
+#define glTexParameterf glStatsTexParameterf
+#undef glUniform1i
+#define glUniform1i glStatsUniform1i
+#undef glUniform2i
+#define glUniform2i glStatsUniform2i
+#undef glUniform4i
+#define glUniform4i glStatsUniform4i
+#undef glUniform1f
+#define glUniform1f glStatsUniform1f
+#undef glUniform2f
+#define glUniform2f glStatsUniform2f
+#undef glUniform4f
+#define glUniform4f glStatsUniform4f
+#undef glUniform1fv
+#define glUniform1fv glStatsUniform1fv
+#undef glUniform2fv
+#define glUniform2fv glStatsUniform2fv
+#undef glUniform3fv
+#define glUniform3fv glStatsUniform3fv
+#undef glUniform4fv
+#define glUniform4fv glStatsUniform4fv
+#undef glUniformMatrix4fv
+#define glUniformMatrix4fv glStatsUniformMatrix4fv
+#undef glGenTextures
+#define glGenTextures glStatsGenTextures
+#undef glDeleteTextures
+#define glDeleteTextures glStatsDeleteTextures
+#undef glGenFramebuffers
+#define glGenFramebuffers glStatsGenFramebuffers
+#undef glDeleteFramebuffers
+#define glDeleteFramebuffers glStatsDeleteFramebuffers
+#undef glGenRenderbuffers
+#define glGenRenderbuffers glStatsGenRenderbuffers
+#undef glDeleteRenderbuffers
+#define glDeleteRenderbuffers glStatsDeleteRenderbuffers
+#undef glTexImage3D
+#define glTexImage3D glStatsTexImage3D
+#undef glTexSubImage3D
+#define glTexSubImage3D glStatsTexSubImage3D
+#undef glBufferData
+#define glBufferData glStatsBufferData
+#undef glReadPixels
+#define glReadPixels glStatsReadPixels
+#endif
+
+#endif //GLSTATS_H_INCLUDED
@@ -0,0 +1,233 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright © 2025 Jon DuBois. Written with the assistance of GPT-4 et al.   //
+////////////////////////////////////////////////////////////////////////////////
+
+// Micro-benchmarks for the CPU tensor kernels, built by make kernelbench. It
+// links everything but main.c and never opens a window, so only host memory
+// paths can be timed. Usage:
+//   Atlas-kernelbench [--max N] [FILE]
+// Results are written to FILE as JSON, or stdout if it is omitted or -.
+
+#include "Atlas.h"
+
+// Each kernel is run until this much time has been spent on it.
+#define TARGET_SECONDS 0.25
+#define MAX_ITERATIONS 10000
+
+typedef enum{
+  KADD, KMUL, KPOW, KSUM, KMINMAX, KSORT, KMULTIPLY, KCAT, KINDEX,
+  KCONTIGUOUS, KREPEAT, KFORMAT, KERNELCOUNT
+} kernel;
+
+static const char* kernelNames[ KERNELCOUNT ] = {
+  "add", "mul", "pow", "sum", "minmax", "sort", "multiply", "cat", "index",
+  "ensureContiguous", "repeat", "formatTensorData"
+};
+// Kernels that are worse than linear are only run up to this many elements.
+static const u32 kernelMax[ KERNELCOUNT ] = {
+  0, 0, 0, 0, 0, 0, 262144, 0, 0, 0, 0, 262144
+};
+// Square sizes from 4 to 16M elements, so matrices can be transposed.
+static const u32 sizes[] = { 4, 64, 1024, 16384, 262144, 4194304, 16777216 };
+#define SIZECOUNT ( sizeof( sizes ) / sizeof( sizes[ 0 ] ) )
+
+static tensorStack* ts = NULL;
+static program* prog = NULL;
+
+// Runs one step of type through runProgram, as a script would.
+static void runStep( u32 type ){
+  prog->steps[ 0 ].type = type;
+  bool ret = true;
+  char* msg = runProgram( ts, &prog, 0, &ret );
+  if( msg )
+    error( "%s", msg );
+}
+
+// Returns a new tensor of count elements counting down from count - 1, as a
+// square matrix or a vector.
+static tensor* benchTensor( u32 count, bool matrix ){
+  f32* data = mem( count, f32 );
+  for( u32 i = 0; i < count; ++i )
+    data[ i ] = ( count - 1 - i ) * ( 1.0f / count ) + 0.5f;
+  u32 side = sqrt( count );
+  u32 shape[ 2 ] = { side, side };
+  if( !matrix )
+    shape[ 0 ] = count;
+  return newTensor( matrix ? 2 : 1, shape, data );
+}
+
+// Times one run of k on the views a and b, which it consumes. Setup such as
+// pushing operands is left out, but copies the engine makes are not.
+static f64 runKernel( kernel k, tensor* a, tensor* b, tensor* indices ){
+  u64 start = 0, end = 0;
+  switch( k ){
+  case KADD:
+  case KMUL:
+  case KPOW:
+    push( ts, b );
+    push( ts, a );
+    start = SDL_GetPerformanceCounter();
+    runStep( k == KADD ? ADD : k == KMUL ? MUL : POW );
+    end = SDL_GetPerformanceCounter();
+    pop( ts );
+    break;
+  case KSUM:
+  case KMINMAX:
+  case KSORT:
+    deleteTensor( b );
+    push( ts, a );
+    start = SDL_GetPerformanceCounter();
+    runStep( k == KSUM ? SUM : k == KMINMAX ? MINMAX : SORT );
+    end = SDL_GetPerformanceCounter();
+    pop( ts );
+    break;
+  case KMULTIPLY: {
+    start = SDL_GetPerformanceCounter();
+    tensor* r = tensorMultiplyHelper( a, b );
+    end = SDL_GetPerformanceCounter();
+    deleteTensor( r );
+    deleteTensor( a );
+    deleteTensor( b );
+    break;
+  }
+  case KCAT: {
+    start = SDL_GetPerformanceCounter();
+    char* msg = tensorCatHelper( a, b, 0 );
+    end = SDL_GetPerformanceCounter();
+    if( msg )
+      error( "%s", msg );
+    deleteTensor( a );
+    deleteTensor( b );
+    break;
+  }
+  case KINDEX: {
+    tensor* r = NULL;
+    start = SDL_GetPerformanceCounter();
+    char* msg = tensorIndexHelper( a, indices, 0, &r );
+    end = SDL_GetPerformanceCounter();
+    if( msg )
+      error( "%s", msg );
+    deleteTensor( r );
+    deleteTensor( a );
+    deleteTensor( b );
+    break;
+  }
+  case KCONTIGUOUS:
+    start = SDL_GetPerformanceCounter();
+    tensorEnsureContiguous( a );
+    end = SDL_GetPerformanceCounter();
+    deleteTensor( a );
+    deleteTensor( b );
+    break;
+  case KREPEAT: {
+    start = SDL_GetPerformanceCounter();
+    char* msg = tensorRepeatHelper( a, 2 );
+    end = SDL_GetPerformanceCounter();
+    if( msg )
+      error( "%s", msg );
+    deleteTensor( a );
+    deleteTensor( b );
+    break;
+  }
+  case KFORMAT: {
+    start = SDL_GetPerformanceCounter();
+    char* str = formatTensorData( a, 4 );
+    end = SDL_GetPerformanceCounter();
+    unmem( str );
+    deleteTensor( a );
+    deleteTensor( b );
+    break;
+  }
+  default:
+    error( "Unknown kernel %u.", k );
+  }
+  return (f64)( end - start ) / (f64)SDL_GetPerformanceFrequency();
+}
+
+// Returns a view of t laid out as named, contiguous, transposed or reversed.
+static tensor* benchView( tensor* t, const char* layout ){
+  tensor* ret = copyTensor( t );
+  if( !strcmp( layout, "transposed" ) )
+    tensorTransposeHelper( ret, 0, 1 );
+  else if( !strcmp( layout, "reversed" ) )
+    tensorReverseHelper( ret, 0 );
+  return ret;
+}
+
+static void benchKernel( FILE* f, kernel k, u32 count, const char* layout, bool* first ){
+  bool matrix = k != KSORT;
+  tensor* a = benchTensor( count, matrix );
+  tensor* b = benchTensor( count, matrix );
+  // A permutation of the rows of a, for index.
+  u32 rows = a->shape[ 0 ];
+  f32* idata = mem( rows, f32 );
+  for( u32 i = 0; i < rows; ++i )
+    idata[ i ] = ( i * 7919u ) % rows;
+  tensor* indices = newTensor( 1, &rows, idata );
+
+  f64 total = 0.0, best = 1e30;
+  u32 iterations = 0;
+  while( iterations < MAX_ITERATIONS && ( !iterations || total < TARGET_SECONDS ) ){
+    f64 t = runKernel( k, benchView( a, layout ), benchView( b, layout ), indices );
+    total += t;
+    if( t < best )
+      best = t;
+    ++iterations;
+  }
+  deleteTensor( a );
+  deleteTensor( b );
+  deleteTensor( indices );
+
+  fprintf( f, "%s\n    { \"kernel\": ", *first ? "" : "," );
+  benchWriteString( f, kernelNames[ k ] );
+  fprintf( f, ", \"layout\": " );
+  benchWriteString( f, layout );
+  fprintf( f, ", \"elements\": %u, \"iterations\": %u, "
+           "\"meanMs\": %.6f, \"minMs\": %.6f, \"nsPerElement\": %.4f }",
+           count, iterations, total / iterations * 1000.0, best * 1000.0,
+           best * 1e9 / count );
+  *first = false;
+  fflush( f );
+}
+
+int main( int argc, char** argv ){
+  u32 maxElements = 16777216;
+  const char* outFile = "-";
+  for( int i = 1; i < argc; ++i ){
+    if( !strcmp( argv[ i ], "--max" ) && i + 1 < argc )
+      maxElements = strtoul( argv[ ++i ], NULL, 10 );
+    else
+      outFile = argv[ i ];
+  }
+  FILE* f = strcmp( outFile, "-" ) ? fopen( outFile, "w" ) : stdout;
+  if( !f )
+    error( "Failed to open kernel benchmark output file %s.", outFile );
+
+  // Messages go to stderr so they never end up in the JSON on stdout.
+  printToStderr = true;
+  workspace = printToString( "%s", "" );
+  ts = newStack();
+  prog = mem( 1, program );
+  prog->steps = mem( 1, step );
+  prog->numSteps = 1;
+  prog->steps[ 0 ].filename = "kernelbench";
+
+  fprintf( f, "{\n  \"kernels\": [" );
+  bool first = true;
+  for( u32 k = 0; k < KERNELCOUNT; ++k )
+    for( u32 s = 0; s < SIZECOUNT; ++s ){
+      if( sizes[ s ] > maxElements || ( kernelMax[ k ] && sizes[ s ] > kernelMax[ k ] ) )
+        continue;
+      benchKernel( f, k, sizes[ s ], "contiguous", &first );
+      benchKernel( f, k, sizes[ s ], k == KSORT ? "reversed" : "transposed", &first );
+    }
+  fprintf( f, "\n  ]\n}\n" );
+  if( f != stdout )
+    fclose( f );
+
+  unmem( prog->steps );
+  unmem( prog );
+  deleteStack( ts );
+  unmem( workspace );
+  return 0;
+}
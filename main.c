@@ -4,7 +4,10 @@
 
 #include "Atlas.h"
 
-#ifndef __EMSCRIPTEN__
+#if defined( HEADLESS )
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#elif !defined( __EMSCRIPTEN__ )
 #include "SDL2/SDL_syswm.h"
 #include <dwmapi.h>
 #include <fcntl.h>
@@ -28,38 +31,10 @@
 
 u32 jsWidth = 0;
 u32 jsHeight = 0;
-bool depthTest = false;
-bool additive = false;
 GLuint vao = 0;
-SDL_GameController* controllers[ MAX_CONTROLLERS ] = { NULL };
 SDL_JoystickID joystickIDs[ MAX_CONTROLLERS ] = { -1 };
-f32 joysticks[ MAX_CONTROLLERS * 21 ] = { 0 };
-u32 buttons = 0;
-f32 dx = 0;
-f32 dy = 0;
-f32 posx = 0;
-f32 posy = 0;
-f32 mouseWheel = 0;
-f32 mouseWheelPos = 0.0;
-u8 keys[ SDL_NUM_SCANCODES ] = { 0 };
-// We set this in main to a mallocd empty string then also deallocate it in
-// main.
-char* workspace = NULL;
-
-bool doubleClicks[ 3 ] = { 0 };
-bool touchClicks[ 3 ] = { 0 };
-float pinchZoom = 0.0;
-
-// Main must define these.
-
-#ifdef DEBUG
-MemAlloc* mem_list = NULL;
-SDL_mutex* mem_list_mutex = NULL;  // Use SDL mutex
-#else
-u64 memc = 0;
-#endif
+// The rest of the engine's globals are in globals.c.
 
-SDL_Window* window = NULL;
 SDL_GLContext glContext;
 
 // The compiled program to be run.
@@ -72,23 +47,32 @@ GLuint vbo;
 u64 curTime = 0;
 u64 prevTime = 0;
 u64 startTime = 0;
-f64 runTime = 0.0;
-f64 timeDelta = 0.01;
 f64 rawFrameTime = 0.01;
 f64 frameDelay = 0.0;
 f64 targetFps = 6000;
-#define TEXTINPUTBUFFERSIZE 1048576
-#define TEXTBUFFERSIZE 1048576
-char* textInputBuffer = NULL;
-u64 textInputBufferPos = 0;
-char* textBuffer = NULL;
-u64 textBufferPos = 0;
-u32 fullscreen = 0; // 0 no, 1, maybe, 2, yes
+
+// Command line options, see parseOptions.
+u32 maxFrames = 0; // 0 means run until the program quits.
+bool noPresent = false;
+f64 fixedDelta = 0.0; // If nonzero timeDelta is pinned to this every frame.
+const char* benchOutput = NULL;
+#ifndef __EMSCRIPTEN__
+f64 prewarmBudget = 0.0; // Milliseconds a frame spends building computes yet to run.
+#else
+// The browser has no command line to ask for it, and compiles there stall the
+// page, so it always spends a little of each frame building ahead.
+f64 prewarmBudget = 4.0;
+#endif
+u32 profileOnExit = 0; // Number of profile hotspots to print on exit.
+u32 memProfileOnExit = 0; // Number of allocation sites to print on exit.
+// The framebuffer the display tensor is presented to. Headless builds have no
+// default framebuffer, so they present to an offscreen renderbuffer instead.
+GLuint presentFramebuffer = 0;
 
 u32 EVENT_PASTE = 0;  // Will be initialized in main
 
 // mouse speed
-#ifdef __EMSCRIPTEN__
+#if defined( __EMSCRIPTEN__ ) || defined( HEADLESS )
 float getMouseSpeed(){ return 1.0; }
 #else
 float getMouseSpeed() {
@@ -239,7 +223,7 @@ void resizeWindow( int width, int height ){
 #endif
 
 #ifndef __EMSCRIPTEN__
-void APIENTRY openglDebugCallback( GLenum source,
+void GLAPIENTRY openglDebugCallback( GLenum source,
                                    GLenum type,
                                    GLuint id,
                                    GLenum severity,
@@ -264,6 +248,7 @@ void enableDebugCallback(){
 // Thread synchronization variables
 SDL_atomic_t running;
 // SDL_mutex* data_mutex = NULL;
+#ifndef HEADLESS
 void SetDarkTitleBar( SDL_Window* sdlWindow ){
   SDL_SysWMinfo wmInfo;
   SDL_VERSION( &wmInfo.version );
@@ -285,6 +270,7 @@ void SetDarkTitleBar( SDL_Window* sdlWindow ){
     SDL_Log( "Unable to get window handle: %s", SDL_GetError() );
   }
 }
+#endif
 #else
 int running;  // Simple integer for the running flag in single-threaded mode
 #endif
@@ -342,6 +328,10 @@ void mainPoll( void ){
 #else
       emscripten_cancel_main_loop();
 #endif
+    } else if( replaying ){
+      // Input comes from the recording, live input is dropped.
+      if( event.type == EVENT_PASTE )
+        SDL_free( event.user.data1 );
     } else if( event.type == SDL_MOUSEWHEEL ){
 #ifndef __EMSCRIPTEN__
       // SDL_LockMutex( data_mutex );
@@ -738,7 +728,211 @@ GLuint createProgram( const GLchar* vertexSource,
   return program;
 }
 
+#ifdef HEADLESS
+EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+EGLContext eglContext = EGL_NO_CONTEXT;
+GLuint presentRenderbuffer = 0;
+
+// Creates a surfaceless EGL context, e.g. Mesa llvmpipe on a box with no
+// display and no GPU, and makes it current on the calling thread.
+void createHeadlessContext( void ){
+  PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+    (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress( "eglGetPlatformDisplayEXT" );
+  if( getPlatformDisplay )
+    eglDisplay = getPlatformDisplay( EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL );
+  if( eglDisplay == EGL_NO_DISPLAY )
+    eglDisplay = eglGetDisplay( EGL_DEFAULT_DISPLAY );
+  if( eglDisplay == EGL_NO_DISPLAY || !eglInitialize( eglDisplay, NULL, NULL ) )
+    error( "eglInitialize Error: 0x%x\n", eglGetError() );
+  if( !eglBindAPI( EGL_OPENGL_API ) )
+    error( "eglBindAPI Error: 0x%x\n", eglGetError() );
+
+  const EGLint configAttribs[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+                                   EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+                                   EGL_NONE };
+  EGLConfig config = NULL;
+  EGLint numConfigs = 0;
+  if( !eglChooseConfig( eglDisplay, configAttribs, &config, 1, &numConfigs ) || !numConfigs )
+    config = NULL; // EGL_KHR_no_config_context
+
+  eglContext = eglCreateContext( eglDisplay, config, EGL_NO_CONTEXT, NULL );
+  if( eglContext == EGL_NO_CONTEXT )
+    error( "eglCreateContext Error: 0x%x\n", eglGetError() );
+  if( !eglMakeCurrent( eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, eglContext ) )
+    error( "eglMakeCurrent Error: 0x%x (EGL_KHR_surfaceless_context required)\n", eglGetError() );
+}
+
+// Creates the offscreen target the display tensor is presented to.
+void createPresentFramebuffer( int width, int height ){
+  glGenRenderbuffers( 1, &presentRenderbuffer );
+  glBindRenderbuffer( GL_RENDERBUFFER, presentRenderbuffer );
+  glRenderbufferStorage( GL_RENDERBUFFER, GL_RGBA8, width, height );
+  glBindRenderbuffer( GL_RENDERBUFFER, 0 );
+  glGenFramebuffers( 1, &presentFramebuffer );
+  glBindFramebuffer( GL_FRAMEBUFFER, presentFramebuffer );
+  glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, presentRenderbuffer );
+  if( glCheckFramebufferStatus( GL_FRAMEBUFFER ) != GL_FRAMEBUFFER_COMPLETE )
+    error( "%s", "Present framebuffer is not complete." );
+  glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+}
+
+void deleteHeadlessContext( void ){
+  glDeleteFramebuffers( 1, &presentFramebuffer );
+  glDeleteRenderbuffers( 1, &presentRenderbuffer );
+  presentFramebuffer = presentRenderbuffer = 0;
+  eglMakeCurrent( eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT );
+  eglDestroyContext( eglDisplay, eglContext );
+  eglTerminate( eglDisplay );
+  eglContext = EGL_NO_CONTEXT;
+  eglDisplay = EGL_NO_DISPLAY;
+}
+#endif
+
 #ifndef __EMSCRIPTEN__
+// Strips leading options out of argv, leaving the script name and its
+// arguments. Returns the new argc.
+//   --frames N    Quit after N frames.
+//   --no-present  Skip the present pass; only runProgram is executed.
+//   --delta S     Use a fixed timeDelta of S seconds, runTime advances by S
+//                 every frame.
+//   --bench FILE  Write frame timings to FILE as JSON on exit, - for stdout.
+//                 Defaults to 600 frames with a delta of 1/60.
+//   --profile N   Profile every step and print the N hottest on exit.
+//   --trace FILE  Write a Chrome trace event timeline to FILE.
+//   --mem-profile N  Count allocations per step and C call site, and print
+//                    the N busiest of each on exit.
+//   --record FILE Record the input state of every frame to FILE.
+//   --replay FILE Replay input, timeDelta and runTime recorded with --record,
+//                 quitting when the recording ends.
+//   --shader-cache DIR  Save linked shader binaries in DIR and load them on
+//                       later runs instead of compiling.
+//   --prewarm MS  Spend up to MS milliseconds a frame building the shaders of
+//                 computes that have not run yet.
+int parseOptions( int argc, char** argv ){
+  int i = 1;
+  for( ; i < argc && !strncmp( argv[ i ], "--", 2 ); ++i ){
+    if( !strcmp( argv[ i ], "--frames" ) && i + 1 < argc )
+      maxFrames = strtoul( argv[ ++i ], NULL, 10 );
+    else if( !strcmp( argv[ i ], "--no-present" ) )
+      noPresent = true;
+    else if( !strcmp( argv[ i ], "--delta" ) && i + 1 < argc )
+      fixedDelta = strtod( argv[ ++i ], NULL );
+    else if( !strcmp( argv[ i ], "--bench" ) && i + 1 < argc )
+      benchOutput = argv[ ++i ];
+    else if( !strcmp( argv[ i ], "--profile" ) && i + 1 < argc ){
+      profileOnExit = strtoul( argv[ ++i ], NULL, 10 );
+      profileStart();
+    }
+    else if( !strcmp( argv[ i ], "--trace" ) && i + 1 < argc )
+      traceStart( argv[ ++i ] );
+    else if( !strcmp( argv[ i ], "--mem-profile" ) && i + 1 < argc ){
+      memProfileOnExit = strtoul( argv[ ++i ], NULL, 10 );
+      memProfileStart();
+    }
+    else if( !strcmp( argv[ i ], "--record" ) && i + 1 < argc )
+      recordStart( argv[ ++i ] );
+    else if( !strcmp( argv[ i ], "--replay" ) && i + 1 < argc )
+      replayStart( argv[ ++i ] );
+    else if( !strcmp( argv[ i ], "--shader-cache" ) && i + 1 < argc )
+      shaderCacheDirectory( argv[ ++i ] );
+    else if( !strcmp( argv[ i ], "--prewarm" ) && i + 1 < argc )
+      prewarmBudget = strtod( argv[ ++i ], NULL );
+    else
+      error( "Unknown option %s.\n", argv[ i ] );
+  }
+  int skipped = i - 1;
+  for( ; i < argc; ++i )
+    argv[ i - skipped ] = argv[ i ];
+  argc -= skipped;
+
+  if( benchOutput ){
+    if( !maxFrames )
+      maxFrames = 600;
+    if( !fixedDelta )
+      fixedDelta = 1.0 / 60.0;
+    benchStart( benchOutput, argc >= 2 ? argv[ 1 ] : NULL, maxFrames, fixedDelta );
+  }
+  if( fixedDelta )
+    timeDelta = fixedDelta;
+  return argc;
+}
+
+// Records one benchmark frame from performance counter readings.
+void recordBenchFrame( u64 frameStart, u64 runStart, u64 runEnd, u64 presentStart, s64 memStart ){
+  f64 freq = (f64)SDL_GetPerformanceFrequency();
+  u64 now = SDL_GetPerformanceCounter();
+  benchFrame frame = { ( now - frameStart ) / freq,
+                       ( runEnd - runStart ) / freq,
+                       ( now - presentStart ) / freq,
+                       benchMemCount() - memStart };
+  benchRecord( &frame );
+}
+
+// Draws the tensor on top of the stack to the present framebuffer.
+void presentTop( int windowWidth, int windowHeight ){
+  if( !ts->stack[ ts->size - 1 ]->gpu )
+    tensorToGPUMemory( ts->stack[ ts->size - 1 ] );
+  if( ts->stack[ ts->size - 1 ]->rank != 3 )
+    error( "%s", "Display tensor not of rank 3" );
+  if( ts->stack[ ts->size - 1 ]->shape[ 2 ] != 4 )
+    error( "%s", "Display tensor not a 4 component tensor of rank 3." );
+  if( ts->stack[ ts->size - 1 ]->tex.channels != 400 )
+    error( "%s", "Display tensor not a 4 channel half float tensor of rank 3." );
+
+  glBindFramebuffer( GL_FRAMEBUFFER, presentFramebuffer );
+  glClear( GL_COLOR_BUFFER_BIT );
+
+  glUseProgram( shaderProgram );
+  glViewport( 0, 0, windowWidth, windowHeight );
+
+  GLint texLoc = glGetUniformLocation( shaderProgram, "tex" );
+  glUniform1i( texLoc, 0 );  // Texture unit 0
+
+  // Bind the texture to texture unit 0
+  glActiveTexture( GL_TEXTURE0 );
+  glBindTexture( GL_TEXTURE_2D_ARRAY,
+                 ts->stack[ ts->size - 1 ]->tex.texture );
+
+  // Set uniforms
+  GLint dimsLoc = glGetUniformLocation( shaderProgram, "dims" );
+  glUniform2f( dimsLoc,
+               ts->stack[ ts->size - 1 ]->tex.width,
+               ts->stack[ ts->size - 1 ]->tex.height );
+
+  GLint resolutionLoc = glGetUniformLocation( shaderProgram, "resolution" );
+  glUniform2f( resolutionLoc, (float)windowWidth, (float)windowHeight );
+
+  GLint stridesLoc = glGetUniformLocation( shaderProgram, "strides" );
+  glUniform4f( stridesLoc,
+               ts->stack[ ts->size - 1 ]->strides[ 0 ],
+               ts->stack[ ts->size - 1 ]->strides[ 1 ],
+               ts->stack[ ts->size - 1 ]->strides[ 2 ],
+               ts->stack[ ts->size - 1 ]->strides[ 3 ] );
+  GLint shapeLoc = glGetUniformLocation( shaderProgram, "shape" );
+  glUniform4f( shapeLoc,
+               ts->stack[ ts->size - 1 ]->shape[ 0 ],
+               ts->stack[ ts->size - 1 ]->shape[ 1 ],
+               ts->stack[ ts->size - 1 ]->shape[ 2 ],
+               ts->stack[ ts->size - 1 ]->shape[ 3 ] );
+
+  GLint toffsetLoc = glGetUniformLocation( shaderProgram, "toffset" );
+  glUniform1f( toffsetLoc, ts->stack[ ts->size - 1 ]->offset );
+
+  // Bind VBO and set vertex attributes
+  glBindBuffer( GL_ARRAY_BUFFER, vbo );
+  GLint posAttrib = glGetAttribLocation( shaderProgram, "position" );
+  glEnableVertexAttribArray( posAttrib );
+  glVertexAttribPointer( posAttrib, 2, GL_FLOAT, GL_FALSE, 0, 0 );
+
+  // Draw
+  glDrawArrays( GL_TRIANGLE_STRIP, 0, 4 );
+
+  // Cleanup
+  glDisableVertexAttribArray( posAttrib );
+  glBindTexture( GL_TEXTURE_2D_ARRAY, 0 );
+  glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+}
+
 // Rendering and computation thread function
 int renderThreadFunction( void* data ){
   LaunchArgs* args = (LaunchArgs*)data;
@@ -748,9 +942,13 @@ int renderThreadFunction( void* data ){
   const char* fileName = ( args->argc >= 2 ) ? args->argv[ 1 ] : NULL;
 
   // Create the OpenGL context in the render thread
+#ifdef HEADLESS
+  createHeadlessContext();
+#else
   glContext = SDL_GL_CreateContext( window );
   if( !glContext )
     error( "SDL_GL_CreateContext Error: %s\n", SDL_GetError() );
+#endif
   // Initialize GLEW
   glewExperimental = GL_TRUE;  // Enable modern OpenGL techniques
   GLenum glewError = glewInit();
@@ -768,8 +966,12 @@ int renderThreadFunction( void* data ){
   SDL_GetWindowSize( window, &windowWidth, &windowHeight );
   glViewport( 0, 0, windowWidth, windowHeight );
   glClearColor( 0.0f, 0.0f, 0.0f, 1.0f );
+#ifdef HEADLESS
+  createPresentFramebuffer( windowWidth, windowHeight );
+#else
   SDL_GL_SetSwapInterval( 1 );  // VRR
   SDL_SetHint( SDL_HINT_RENDER_VSYNC, "1" );
+#endif
   /* SDL_GL_SetSwapInterval( 0 ); */
   /* SDL_SetHint(SDL_HINT_RENDER_VSYNC, "0"); */
 
@@ -802,13 +1004,37 @@ int renderThreadFunction( void* data ){
   }
 
   // Main loop
+  u32 frameCount = 0;
   while( SDL_AtomicGet( &running ) ){
+    if( maxFrames && frameCount >= maxFrames ){
+      SDL_AtomicSet( &running, 0 );
+      break;
+    }
+    ++frameCount;
+    if( !inputFrame() ){
+      SDL_AtomicSet( &running, 0 );
+      break;
+    }
+    glStatsFrame();
+    if( memProfiling )
+      memProfileFrame();
+    u64 frameStart = SDL_GetPerformanceCounter();
+    s64 memStart = benchMemCount();
     // SDL_PumpEvents();
     // mainPoll();
     //  Run the program
     CHECK_GL_ERROR();
     bool ret;
+    u64 runStart = SDL_GetPerformanceCounter();
     char* msg = runProgram( ts, &prog, 0, &ret );
+    tensorEndFrame( ts );
+    u64 runEnd = SDL_GetPerformanceCounter();
+    if( memProfiling )
+      memProfileStep( NULL, 0, 0 );
+    if( tracing )
+      traceComplete( "frame", runStart, "runProgram" );
+    if( gpuProfiling )
+      gpuProfileCollect( false );
     if( msg )
       error( "%s", msg );
     if( !ret ){
@@ -836,75 +1062,32 @@ int renderThreadFunction( void* data ){
 #endif
 
     // Get current window size
-    SDL_GetWindowSize( window, &windowWidth, &windowHeight );
+    inputWindowSize( &windowWidth, &windowHeight );
 
     // Adjust the viewport
     glViewport( 0, 0, windowWidth, windowHeight );
 
+    // Build pending shaders, even on frames with nothing to present.
+    if( prewarmBudget ){
+      u64 prewarmStart = SDL_GetPerformanceCounter();
+      prewarmComputes( prog, prewarmBudget );
+      if( tracing )
+        traceComplete( "frame", prewarmStart, "prewarm" );
+    }
+
     // Render
-    if( !ts->size )
+    if( !ts->size ){
+      if( benchmarking )
+        recordBenchFrame( frameStart, runStart, runEnd, runEnd, memStart );
+      if( tracing )
+        traceComplete( "frame", frameStart, "frame %u", frameCount );
       continue;
-    if( !ts->stack[ ts->size - 1 ]->gpu )
-      tensorToGPUMemory( ts->stack[ ts->size - 1 ] );
-    if( ts->stack[ ts->size - 1 ]->rank != 3 )
-      error( "%s", "Display tensor not of rank 3" );
-    if( ts->stack[ ts->size - 1 ]->shape[ 2 ] != 4 )
-      error( "%s", "Display tensor not a 4 component tensor of rank 3." );
-    if( ts->stack[ ts->size - 1 ]->tex.channels != 400 )
-      error( "%s", "Display tensor not a 4 channel half float tensor of rank 3." );
-
-
-    glClear( GL_COLOR_BUFFER_BIT );
-
-    glUseProgram( shaderProgram );
-    glViewport( 0, 0, windowWidth, windowHeight );
-
-    GLint texLoc = glGetUniformLocation( shaderProgram, "tex" );
-    glUniform1i( texLoc, 0 );  // Texture unit 0
-
-    // Bind the texture to texture unit 0
-    glActiveTexture( GL_TEXTURE0 );
-    glBindTexture( GL_TEXTURE_2D_ARRAY,
-                   ts->stack[ ts->size - 1 ]->tex.texture );
-
-    // Set uniforms
-    GLint dimsLoc = glGetUniformLocation( shaderProgram, "dims" );
-    glUniform2f( dimsLoc,
-                 ts->stack[ ts->size - 1 ]->tex.width,
-                 ts->stack[ ts->size - 1 ]->tex.height );
-
-    GLint resolutionLoc = glGetUniformLocation( shaderProgram, "resolution" );
-    glUniform2f( resolutionLoc, (float)windowWidth, (float)windowHeight );
-
-    GLint stridesLoc = glGetUniformLocation( shaderProgram, "strides" );
-    glUniform4f( stridesLoc,
-                 ts->stack[ ts->size - 1 ]->strides[ 0 ],
-                 ts->stack[ ts->size - 1 ]->strides[ 1 ],
-                 ts->stack[ ts->size - 1 ]->strides[ 2 ],
-                 ts->stack[ ts->size - 1 ]->strides[ 3 ] );
-    GLint shapeLoc = glGetUniformLocation( shaderProgram, "shape" );
-    glUniform4f( shapeLoc,
-                 ts->stack[ ts->size - 1 ]->shape[ 0 ],
-                 ts->stack[ ts->size - 1 ]->shape[ 1 ],
-                 ts->stack[ ts->size - 1 ]->shape[ 2 ],
-                 ts->stack[ ts->size - 1 ]->shape[ 3 ] );
-
-    GLint toffsetLoc = glGetUniformLocation( shaderProgram, "toffset" );
-    glUniform1f( toffsetLoc, ts->stack[ ts->size - 1 ]->offset );
-
-    // Bind VBO and set vertex attributes
-    glBindBuffer( GL_ARRAY_BUFFER, vbo );
-    GLint posAttrib = glGetAttribLocation( shaderProgram, "position" );
-    glEnableVertexAttribArray( posAttrib );
-    glVertexAttribPointer( posAttrib, 2, GL_FLOAT, GL_FALSE, 0, 0 );
-
-    // Draw
-    glBindFramebuffer( GL_FRAMEBUFFER, 0 );
-    glDrawArrays( GL_TRIANGLE_STRIP, 0, 4 );
-
-    // Cleanup
-    glDisableVertexAttribArray( posAttrib );
-    glBindTexture( GL_TEXTURE_2D_ARRAY, 0 );
+    }
+    u64 presentStart = SDL_GetPerformanceCounter();
+    if( !noPresent )
+      presentTop( windowWidth, windowHeight );
+    if( tracing )
+      traceComplete( "frame", presentStart, "present" );
 
 #ifndef EMSCRIPTEN // only need this for native afaict
     //glFinish();
@@ -914,26 +1097,62 @@ int renderThreadFunction( void* data ){
     prevTime = curTime;
     curTime = SDL_GetPerformanceCounter();
     rawFrameTime = (f64)( curTime - prevTime ) / (f64)( SDL_GetPerformanceFrequency() );
-    timeDelta *= 0.5; timeDelta += 0.5 * rawFrameTime;
-      
-    runTime =
-      (f64)( curTime - startTime ) / (f64)( SDL_GetPerformanceFrequency() );
-    delay();
+    if( fixedDelta ){
+      timeDelta = fixedDelta;
+      runTime = frameCount * fixedDelta;
+    } else {
+      timeDelta *= 0.5; timeDelta += 0.5 * rawFrameTime;
+      runTime =
+        (f64)( curTime - startTime ) / (f64)( SDL_GetPerformanceFrequency() );
+    }
+    u64 delayStart = SDL_GetPerformanceCounter();
+#ifndef HEADLESS
+    if( !benchmarking )
+      delay();
+#endif
+    if( tracing )
+      traceComplete( "frame", delayStart, "delay" );
+    u64 swapStart = SDL_GetPerformanceCounter();
+#ifdef HEADLESS
+    glFinish();
+#else
     SDL_GL_SwapWindow( window );
+#endif
+    if( tracing ){
+      traceComplete( "frame", swapStart, "swap" );
+      traceComplete( "frame", frameStart, "frame %u", frameCount );
+    }
+    if( benchmarking )
+      recordBenchFrame( frameStart, runStart, runEnd, presentStart, memStart );
 
     // DwmFlush();
   }
 
+  benchFinish();
+  traceFinish();
+  inputFinish();
+  if( profileOnExit )
+    profileReport( profileOnExit );
+  profileReset();
+  if( memProfileOnExit )
+    memProfileReport( memProfileOnExit );
+  memProfileReset();
+
   // Cleanup
   glDeleteProgram( shaderProgram );
   glDeleteBuffers( 1, &vbo );
 
   deleteProgram( prog );
   deleteStack( ts );
+  shaderCacheClear();
 
   glDeleteVertexArrays( 1, &vao );
   vao = 0;
+#ifdef HEADLESS
+  deleteHeadlessContext();
+#else
   SDL_GL_DeleteContext( glContext );
+#endif
 
   return 0;
 }
@@ -949,6 +1168,7 @@ void main_loop( void ){
   CHECK_GL_ERROR();
   bool ret;
   char* err = runProgram( ts, &prog, 0, &ret );
+  tensorEndFrame( ts );
   if( err )
     error( "%s", err );
   if( !ret ){
@@ -970,6 +1190,10 @@ void main_loop( void ){
     return;
   }
 
+  // Build pending shaders, even on frames with nothing to present.
+  if( prewarmBudget )
+    prewarmComputes( prog, prewarmBudget );
+
   // Rendering code
   // Get current window size
   int windowWidth, windowHeight;
@@ -1071,6 +1295,8 @@ int main( int argc, char* argv[] )
   textInputBuffer = mem( TEXTINPUTBUFFERSIZE, char );
   textBuffer = mem( TEXTBUFFERSIZE, char );
 #ifndef __EMSCRIPTEN__
+  argc = parseOptions( argc, argv );
+#ifndef HEADLESS
 
   // 1. Get the handle
   HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
@@ -1118,6 +1344,7 @@ int main( int argc, char* argv[] )
 
   // Set UTF-8 to handle special chars correctly in Emacs
   SetConsoleOutputCP(CP_UTF8);
+#endif
 
   SDL_AtomicSet( &running, 1 );
 
@@ -1137,6 +1364,10 @@ int main( int argc, char* argv[] )
   setvbuf( stderr, NULL, _IONBF, 0 );  // Unbuffer stderr
 
   // Initialize SDL and create window in the main thread
+#ifdef HEADLESS
+  // There is no display; the window only exists to carry a size and events.
+  SDL_SetHint( SDL_HINT_VIDEODRIVER, "dummy" );
+#endif
   if( SDL_Init( SDL_INIT_VIDEO | SDL_INIT_GAMECONTROLLER ) != 0 )
     error( "SDL_Init Error: %s\n", SDL_GetError() );
   EVENT_PASTE = SDL_RegisterEvents( 1 );
@@ -1146,6 +1377,14 @@ int main( int argc, char* argv[] )
   //  SDL_GL_CONTEXT_PROFILE_CORE );
   SDL_GL_SetAttribute( SDL_GL_DOUBLEBUFFER, 1 );
 
+#ifdef HEADLESS
+  window = SDL_CreateWindow( "Atlas",
+                             SDL_WINDOWPOS_UNDEFINED,
+                             SDL_WINDOWPOS_UNDEFINED,
+                             1024,
+                             768,  // Size of the offscreen present target
+                             SDL_WINDOW_HIDDEN );
+#else
   // Add SDL_WINDOW_RESIZABLE flag
   window = SDL_CreateWindow( "Atlas",
                              SDL_WINDOWPOS_CENTERED,
@@ -1154,9 +1393,10 @@ int main( int argc, char* argv[] )
                              768,  // Initial window size
                              SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN |
                              SDL_WINDOW_RESIZABLE );
+#endif
   if( !window )
     error( "SDL_CreateWindow Error: %s\n", SDL_GetError() );
-#ifndef __EMSCRIPTEN__
+#if !defined( __EMSCRIPTEN__ ) && !defined( HEADLESS )
   SetDarkTitleBar( window );
 #endif
 
@@ -1242,6 +1482,7 @@ int main( int argc, char* argv[] )
 #ifdef __EMSCRIPTEN__
   deleteProgram( prog );
   deleteStack( ts );
+  shaderCacheClear();
   SDL_GL_DeleteContext( glContext );
 #endif
 
@@ -1259,79 +1500,3 @@ int main( int argc, char* argv[] )
   return 0;
 #endif
 }
-
-float getMaxAnisotropy( void ){
-  static float ret = 0.0;
-  if( ret )
-    return ret;
-  // Check if the anisotropic filtering extension is supported
-  const char* extensions = (const char*)glGetString( GL_EXTENSIONS );
-  if( extensions && strstr( extensions, "EXT_texture_filter_anisotropic" ) ){
-    // Retrieve the extension
-    GLfloat maxAnisotropy = 1.0f;
-    glGetFloatv( GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &maxAnisotropy );
-    ret = maxAnisotropy;
-  } else {
-    ret = 1.0f;  // Default value (no anisotropic filtering)
-  }
-  return ret;
-}
-void vPrintToBuffer( const char* format, va_list args ){
-  va_list len_args;
-  va_copy( len_args, args );
-  int needed = vsnprintf( NULL, 0, format, len_args );
-  va_end( len_args );
-
-  if( needed < 0 ) return;
-
-  int available = TEXTBUFFERSIZE - textBufferPos - 1;
-  if( needed > available ){
-    size_t discard_amount = textBufferPos / 2;
-    if( needed > (int)( TEXTBUFFERSIZE - ( textBufferPos - discard_amount ) ) ){
-      size_t keep = ( TEXTBUFFERSIZE - 1 ) - needed;
-      if( keep > textBufferPos ) keep = 0;
-      discard_amount = textBufferPos - keep;
-    }
-    memmove( textBuffer, textBuffer + discard_amount, textBufferPos - discard_amount );
-    textBufferPos -= discard_amount;
-  }
-  vsnprintf( textBuffer + textBufferPos, TEXTBUFFERSIZE - textBufferPos, format, args );
-  
-  textBufferPos += needed;
-  if( textBufferPos >= TEXTBUFFERSIZE ) textBufferPos = TEXTBUFFERSIZE - 1;
-  textBuffer[ textBufferPos ] = '\0';
-}
-
-void printToBuffer( const char* format, ... ){
-  va_list args;
-  va_start( args, format );
-  vPrintToBuffer( format, args );
-  va_end( args );
-}
-
-void print( const char* format, ... ){
-  va_list args;
-  va_start( args, format );
-  va_list stdout_args;
-  va_copy( stdout_args, args );
-  vprintf( format, stdout_args );
-  va_end( stdout_args );
-  vPrintToBuffer( format, args );
-  va_end( args );
-}
-char* printToString( const char* format, ... ){
-  va_list args;
-  va_start( args, format );
-  va_list args_copy;
-  va_copy( args_copy, args );
-  int needed = vsnprintf( NULL, 0, format, args_copy );
-  va_end( args_copy );
-  if( needed < 0 ){
-    va_end( args );
-    return NULL; 
-  }
-  char* str = mem( needed + 1, char );
-  vsnprintf( str, needed + 1, format, args );
-  va_end( args );
-  return str;
-}
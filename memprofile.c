@@ -0,0 +1,196 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright © 2025 Jon DuBois. Written with the assistance of GPT-4 et al.   //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Atlas.h"
+
+// The tables here use calloc and free directly, since going through mem would
+// recurse and show up in memc.
+
+bool memProfiling = false;
+
+typedef struct{
+  char* file; // Owned copy for script locations, a __FILE__ literal otherwise.
+  u32 line;
+  u32 command;
+  u64 count;
+  u64 bytes;
+  u32 frames; // The number of frames this site allocated in.
+  u32 lastFrame;
+} memSite;
+
+// Open addressed table keyed by location, capacity is a power of 2.
+typedef struct{
+  memSite* sites;
+  u32 count;
+  u32 capacity;
+  bool ownsFiles;
+} memSiteTable;
+
+static memSiteTable stepSites = { NULL, 0, 0, true };
+static memSiteTable callSites = { NULL, 0, 0, false };
+static SDL_mutex* memProfileMutex = NULL;
+static const char* curFile = NULL;
+static u32 curLine = 0;
+static u32 curCommand = 0;
+static u32 memFrame = 0;
+static u64 memTotal = 0;
+static u64 memTotalBytes = 0;
+
+static u32 memSiteHash( u32 line, u32 command ){
+  u32 h = line * 2654435761u ^ command * 2246822519u;
+  return h ^ ( h >> 15 );
+}
+
+static void memSiteGrow( memSiteTable* t ){
+  memSite* old = t->sites;
+  u32 oldCapacity = t->capacity;
+  t->capacity = oldCapacity ? oldCapacity * 2 : 1024;
+  t->sites = calloc( t->capacity, sizeof( memSite ) );
+  if( !t->sites ){
+    fprintf( stderr, "Allocation profiler out of memory.\n" );
+    exit( EXIT_FAILURE );
+  }
+  for( u32 i = 0; i < oldCapacity; ++i ){
+    if( !old[ i ].file )
+      continue;
+    u32 j = memSiteHash( old[ i ].line, old[ i ].command ) & ( t->capacity - 1 );
+    while( t->sites[ j ].file )
+      j = ( j + 1 ) & ( t->capacity - 1 );
+    t->sites[ j ] = old[ i ];
+  }
+  free( old );
+}
+
+static void memSiteAdd( memSiteTable* t, const char* file, u32 line, u32 command, u64 bytes ){
+  if( ( t->count + 1 ) * 2 > t->capacity )
+    memSiteGrow( t );
+  u32 j = memSiteHash( line, command ) & ( t->capacity - 1 );
+  while( t->sites[ j ].file &&
+         ( t->sites[ j ].line != line || t->sites[ j ].command != command ||
+           strcmp( t->sites[ j ].file, file ) ) )
+    j = ( j + 1 ) & ( t->capacity - 1 );
+  memSite* s = t->sites + j;
+  if( !s->file ){
+    if( t->ownsFiles ){
+      u64 len = strlen( file );
+      s->file = malloc( len + 1 );
+      memcpy( s->file, file, len + 1 );
+    } else
+      s->file = (char*)file;
+    s->line = line;
+    s->command = command;
+    ++t->count;
+  }
+  s->count++;
+  s->bytes += bytes;
+  if( s->lastFrame != memFrame ){
+    s->lastFrame = memFrame;
+    s->frames++;
+  }
+}
+
+static void memSiteClear( memSiteTable* t ){
+  if( t->ownsFiles )
+    for( u32 i = 0; i < t->capacity; ++i )
+      free( t->sites[ i ].file );
+  free( t->sites );
+  t->sites = NULL;
+  t->count = t->capacity = 0;
+}
+
+void memProfileStart( void ){
+  if( !memProfileMutex )
+    memProfileMutex = SDL_CreateMutex();
+  memFrame = 0;
+  memProfiling = true;
+}
+
+void memProfileAlloc( u64 bytes, const char* file, int line ){
+  // The render thread and the event thread both allocate.
+  SDL_LockMutex( memProfileMutex );
+  memSiteAdd( &stepSites, curFile ? curFile : "(outside runProgram)", curLine, curCommand, bytes );
+  memSiteAdd( &callSites, file, line, 0, bytes );
+  ++memTotal;
+  memTotalBytes += bytes;
+  SDL_UnlockMutex( memProfileMutex );
+}
+
+void memProfileStep( const char* filename, u32 linenum, u32 commandnum ){
+  // Read by memProfileAlloc on the event thread too.
+  SDL_LockMutex( memProfileMutex );
+  curFile = filename;
+  curLine = linenum;
+  curCommand = commandnum;
+  SDL_UnlockMutex( memProfileMutex );
+}
+
+void memProfileFrame( void ){
+  ++memFrame;
+}
+
+static int compareMemSites( const void* a, const void* b ){
+  u64 x = ( *(const memSite* const*)a )->count;
+  u64 y = ( *(const memSite* const*)b )->count;
+  return ( x < y ) - ( x > y );
+}
+
+// Returns the sites sorted by allocation count, most first.
+static memSite** memSorted( const memSiteTable* t ){
+  memSite** sorted = calloc( t->count + 1, sizeof( memSite* ) );
+  u32 n = 0;
+  for( u32 i = 0; i < t->capacity; ++i )
+    if( t->sites[ i ].file )
+      sorted[ n++ ] = t->sites + i;
+  qsort( sorted, n, sizeof( memSite* ), compareMemSites );
+  return sorted;
+}
+
+// A site allocates in steady state if it did so every frame after the first,
+// which is left out since that is where loading and compiling happen.
+static bool memEveryFrame( const memSite* s ){
+  return memFrame > 2 && s->frames + 1 >= memFrame;
+}
+
+static void memReportTable( const memSiteTable* t, u32 count, bool script ){
+  memSite** sorted = memSorted( t );
+  print( "%10s %12s %8s  %s\n", "allocs", "bytes", "frames", script ? "location" : "call site" );
+  for( u32 i = 0; i < t->count && i < count; ++i ){
+    const memSite* s = sorted[ i ];
+    if( script && !s->line )
+      print( "%10llu %12llu %7u%s  %s\n", s->count, s->bytes, s->frames,
+             memEveryFrame( s ) ? "*" : " ", s->file );
+    else if( script )
+      print( "%10llu %12llu %7u%s  %s:%u command %u\n", s->count, s->bytes, s->frames,
+             memEveryFrame( s ) ? "*" : " ", s->file, s->line, s->command );
+    else
+      print( "%10llu %12llu %7u%s  %s:%u\n", s->count, s->bytes, s->frames,
+             memEveryFrame( s ) ? "*" : " ", s->file, s->line );
+  }
+  free( sorted );
+}
+
+void memProfileReport( u32 count ){
+  if( !memProfiling )
+    return;
+  // Printing allocates, which should not show up in the report.
+  memProfiling = false;
+  SDL_LockMutex( memProfileMutex );
+  print( "Allocations: %llu (%llu bytes) in %u frames, * allocates every frame.\n",
+         memTotal, memTotalBytes, memFrame );
+  memReportTable( &stepSites, count, true );
+  memReportTable( &callSites, count, false );
+  SDL_UnlockMutex( memProfileMutex );
+  memProfiling = true;
+}
+
+void memProfileReset( void ){
+  memProfiling = false;
+  SDL_LockMutex( memProfileMutex );
+  memSiteClear( &stepSites );
+  memSiteClear( &callSites );
+  memTotal = memTotalBytes = 0;
+  memFrame = 0;
+  curFile = NULL;
+  SDL_UnlockMutex( memProfileMutex );
+}
@@ -0,0 +1,25 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright © 2025 Jon DuBois. Written with the assistance of GPT-4 et al.   //
+////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef MEMPROFILE_H_INCLUDED
+#define MEMPROFILE_H_INCLUDED
+
+// Allocation profiler. While running, every mem() is counted against the step
+// runProgram is executing and against the C call site, so allocations made
+// every frame can be tracked down. Started by the --mem-profile option. This
+// header is included before the mem macros, which call memProfileAlloc.
+extern bool memProfiling;
+
+void memProfileStart( void );
+void memProfileAlloc( u64 bytes, const char* file, int line );
+// Sets the step allocations are attributed to, filename NULL for none.
+void memProfileStep( const char* filename, u32 linenum, u32 commandnum );
+// Starts a new frame, called once per frame by the render loop.
+void memProfileFrame( void );
+// Prints the count locations and call sites that allocate the most.
+void memProfileReport( u32 count );
+void memProfileReset( void );
+
+#endif //MEMPROFILE_H_INCLUDED
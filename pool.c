@@ -0,0 +1,139 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright © 2025 Jon DuBois. Written with the assistance of GPT-4 et al.   //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Atlas.h"
+
+#ifndef DEBUG
+
+// Classes are every 16 bytes up to 256, then powers of 2 up to POOL_MAX.
+#define POOL_FINE 16
+#define POOL_CLASSES ( POOL_FINE + 4 )
+#define POOL_CHUNK 65536
+
+typedef struct poolBlock{
+  struct poolBlock* next;
+} poolBlock;
+
+// Chunks are carved into blocks of one size class and never returned, sorted by
+// address so poolFree can find the one a pointer lies in.
+typedef struct{
+  u8* start;
+  u32 sizeClass;
+} poolChunk;
+
+static poolBlock* freeLists[ POOL_CLASSES ] = { NULL };
+static poolChunk* chunks = NULL;
+static u32 numChunks = 0;
+static u32 chunkCapacity = 0;
+
+static u32 poolClass( u64 bytes ){
+  if( bytes <= 256 )
+    return bytes ? ( bytes - 1 ) / 16 : 0;
+  u32 sizeClass = POOL_FINE;
+  for( u64 size = 512; size < bytes; size *= 2 )
+    ++sizeClass;
+  return sizeClass;
+}
+static u32 poolClassSize( u32 sizeClass ){
+  return sizeClass < POOL_FINE ? ( sizeClass + 1 ) * 16 : 512u << ( sizeClass - POOL_FINE );
+}
+
+static void poolGrow( u32 sizeClass ){
+  u8* start = malloc( POOL_CHUNK );
+  if( !start ){
+    printf( "OOM: %u byte pool chunk\n", POOL_CHUNK );
+    exit( 1 );
+  }
+  if( numChunks == chunkCapacity ){
+    chunkCapacity = chunkCapacity ? chunkCapacity * 2 : 64;
+    chunks = realloc( chunks, chunkCapacity * sizeof( poolChunk ) );
+    if( !chunks ){
+      printf( "OOM: %u pool chunks\n", chunkCapacity );
+      exit( 1 );
+    }
+  }
+  u32 i = numChunks++;
+  while( i && chunks[ i - 1 ].start > start ){
+    chunks[ i ] = chunks[ i - 1 ];
+    --i;
+  }
+  chunks[ i ].start = start;
+  chunks[ i ].sizeClass = sizeClass;
+
+  u32 size = poolClassSize( sizeClass );
+  for( u32 offset = 0; offset + size <= POOL_CHUNK; offset += size ){
+    poolBlock* b = (poolBlock*)( start + offset );
+    b->next = freeLists[ sizeClass ];
+    freeLists[ sizeClass ] = b;
+  }
+}
+
+void* poolAllocAt( u64 bytes, const char* file, int line ){
+  if( bytes > POOL_MAX )
+    return mem_check( malloc( bytes ), bytes, file, line );
+  u32 sizeClass = poolClass( bytes );
+  if( !freeLists[ sizeClass ] )
+    poolGrow( sizeClass );
+  poolBlock* b = freeLists[ sizeClass ];
+  freeLists[ sizeClass ] = b->next;
+  return mem_check( b, bytes, file, line );
+}
+
+bool poolFree( void* ptr ){
+  u8* p = ptr;
+  u32 lo = 0, hi = numChunks;
+  while( lo < hi ){
+    u32 mid = ( lo + hi ) / 2;
+    if( chunks[ mid ].start > p )
+      hi = mid;
+    else
+      lo = mid + 1;
+  }
+  if( !lo || p >= chunks[ lo - 1 ].start + POOL_CHUNK )
+    return false;
+  poolBlock* b = ptr;
+  u32 sizeClass = chunks[ lo - 1 ].sizeClass;
+  b->next = freeLists[ sizeClass ];
+  freeLists[ sizeClass ] = b;
+  memc--;
+  return true;
+}
+
+static u8* arena = NULL;
+static u64 arenaCapacity = 0;
+static u64 arenaUsed = 0;
+// What this frame asked for, including what did not fit.
+static u64 arenaWanted = 0;
+
+void* arenaAlloc( u64 bytes ){
+  bytes = ( bytes + 15 ) & ~(u64)15;
+  arenaWanted += bytes;
+  if( arenaUsed + bytes > arenaCapacity )
+    return NULL;
+  void* ret = arena + arenaUsed;
+  arenaUsed += bytes;
+  return ret;
+}
+bool arenaOwns( const void* ptr ){
+  const u8* p = ptr;
+  return arena && p >= arena && p < arena + arenaCapacity;
+}
+void arenaReset( void ){
+  if( arenaWanted > arenaCapacity ){
+    u64 capacity = arenaCapacity ? arenaCapacity : ARENA_INITIAL;
+    while( capacity < arenaWanted )
+      capacity *= 2;
+    free( arena );
+    arena = malloc( capacity );
+    if( !arena ){
+      printf( "OOM: %llu byte frame arena\n", (unsigned long long)capacity );
+      exit( 1 );
+    }
+    arenaCapacity = capacity;
+  }
+  arenaUsed = 0;
+  arenaWanted = 0;
+}
+
+#endif // DEBUG
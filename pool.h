@@ -0,0 +1,49 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright © 2025 Jon DuBois. Written with the assistance of GPT-4 et al.   //
+////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef POOL_H_INCLUDED
+#define POOL_H_INCLUDED
+
+// Size classed free lists for tensor headers and small host payloads, so the
+// tensors a script makes and drops every frame reuse memory rather than going
+// through calloc and free. Blocks are not zeroed. Requests over POOL_MAX bytes
+// fall back to the heap. Counted in memc and the memory profiler like mem().
+// Tensors are only made on the render thread, so there is no locking. DEBUG
+// builds use mem and unmem directly so every block is tracked.
+#define POOL_MAX 4096
+
+// The frame arena holds payloads of tensors that usually die within a frame,
+// like the keyboard and gamepad state. Tensors over it do not own their data.
+// tensorEndFrame copies out any left on the stack, then resets it. SET copies
+// out on its own by taking ownership. arenaAlloc returns NULL once the frame
+// has used the arena up, and the arena is grown at the next reset. Not counted
+// in memc. DEBUG builds have no arena.
+#define ARENA_INITIAL 262144
+
+#ifdef DEBUG
+
+#define poolAlloc( bytes ) mem_track( ( bytes ), 1, __FILE__, __LINE__ )
+#define poolUnmem( ptr ) unmem( ptr )
+#define arenaAlloc( bytes ) NULL
+#define arenaOwns( ptr ) false
+#define arenaReset()
+
+#else
+
+void* poolAllocAt( u64 bytes, const char* file, int line );
+// Returns false, doing nothing, if ptr did not come from the pool.
+bool poolFree( void* ptr );
+
+#define poolAlloc( bytes ) poolAllocAt( ( bytes ), __FILE__, __LINE__ )
+// Frees ptr from poolAlloc or mem.
+#define poolUnmem( ptr ) do{ if( !poolFree( ptr ) ) unmem( ptr ); }while( 0 )
+
+void* arenaAlloc( u64 bytes );
+bool arenaOwns( const void* ptr );
+void arenaReset( void );
+
+#endif // DEBUG
+
+#endif //POOL_H_INCLUDED
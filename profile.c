@@ -0,0 +1,338 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright © 2025 Jon DuBois. Written with the assistance of GPT-4 et al.   //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Atlas.h"
+
+bool profiling = false;
+
+typedef struct{
+  char* filename; // Owned copy, programs can be deleted while profiling.
+  u32 linenum;
+  u32 commandnum;
+  u32 type;
+  u64 ticks;
+  u64 calls;
+} profileEntry;
+
+// Open addressed table keyed by location, capacity is a power of 2.
+static profileEntry* entries = NULL;
+static u32 entryCount = 0;
+static u32 entryCapacity = 0;
+static u64 typeTicks[ STEPTYPECOUNT ] = { 0 };
+static u64 typeCalls[ STEPTYPECOUNT ] = { 0 };
+
+static u32 profileHash( u32 linenum, u32 commandnum ){
+  u32 h = linenum * 2654435761u ^ commandnum * 2246822519u;
+  return h ^ ( h >> 15 );
+}
+
+static void profileGrow( void ){
+  profileEntry* old = entries;
+  u32 oldCapacity = entryCapacity;
+  entryCapacity = oldCapacity ? oldCapacity * 2 : 1024;
+  entries = mem( entryCapacity, profileEntry );
+  for( u32 i = 0; i < oldCapacity; ++i ){
+    if( !old[ i ].filename )
+      continue;
+    u32 j = profileHash( old[ i ].linenum, old[ i ].commandnum ) & ( entryCapacity - 1 );
+    while( entries[ j ].filename )
+      j = ( j + 1 ) & ( entryCapacity - 1 );
+    entries[ j ] = old[ i ];
+  }
+  if( old )
+    unmem( old );
+}
+
+void profileStart( void ){
+  profiling = true;
+  gpuProfiling = true;
+}
+
+void profileStep( const char* filename, u32 linenum, u32 commandnum, u32 type, u64 ticks ){
+  if( !filename )
+    filename = "?";
+  if( ( entryCount + 1 ) * 2 > entryCapacity )
+    profileGrow();
+  u32 j = profileHash( linenum, commandnum ) & ( entryCapacity - 1 );
+  // Locations with the same line and command in different files share a hash,
+  // so the filename is only compared once the numbers match.
+  while( entries[ j ].filename &&
+         ( entries[ j ].linenum != linenum || entries[ j ].commandnum != commandnum ||
+           strcmp( entries[ j ].filename, filename ) ) )
+    j = ( j + 1 ) & ( entryCapacity - 1 );
+  profileEntry* e = entries + j;
+  if( !e->filename ){
+    e->filename = printToString( "%s", filename );
+    e->linenum = linenum;
+    e->commandnum = commandnum;
+    e->type = type;
+    ++entryCount;
+  }
+  e->ticks += ticks;
+  e->calls++;
+  typeTicks[ type ] += ticks;
+  typeCalls[ type ]++;
+}
+
+////////////////////////////////////////////////////////////////////
+// GPU compute timing
+
+#define GPU_QUERY_RING 256
+
+bool gpuProfiling = false;
+
+typedef struct{
+  char* filename;
+  u32 linenum;
+  u32 commandnum;
+  u64 ns;
+  u64 calls;
+} gpuEntry;
+
+// Computes are few, so these are searched linearly.
+static gpuEntry* gpuEntries = NULL;
+static u32 gpuEntryCount = 0;
+static u32 gpuEntryCapacity = 0;
+
+static GLuint gpuQueries[ GPU_QUERY_RING ] = { 0 };
+// The entry each query in flight is attributed to, or -1 if the slot is free.
+static s32 gpuSlotEntry[ GPU_QUERY_RING ];
+static u32 gpuNext = 0;
+static bool gpuActive = false;
+static u64 gpuDropped = 0;
+
+static s32 gpuEntryFor( const char* filename, u32 linenum, u32 commandnum ){
+  if( !filename )
+    filename = "?";
+  for( u32 i = 0; i < gpuEntryCount; ++i )
+    if( gpuEntries[ i ].linenum == linenum && gpuEntries[ i ].commandnum == commandnum &&
+        !strcmp( gpuEntries[ i ].filename, filename ) )
+      return i;
+  if( gpuEntryCount == gpuEntryCapacity ){
+    gpuEntryCapacity = gpuEntryCapacity ? gpuEntryCapacity * 2 : 64;
+    gpuEntry* t = mem( gpuEntryCapacity, gpuEntry );
+    if( gpuEntries ){
+      memcpy( t, gpuEntries, gpuEntryCount * sizeof( gpuEntry ) );
+      unmem( gpuEntries );
+    }
+    gpuEntries = t;
+  }
+  gpuEntry* e = gpuEntries + gpuEntryCount;
+  e->filename = printToString( "%s", filename );
+  e->linenum = linenum;
+  e->commandnum = commandnum;
+  return gpuEntryCount++;
+}
+
+#ifndef __EMSCRIPTEN__
+// Accumulates the result of a slot if it is ready, returns false if it is not.
+static bool gpuResolve( u32 slot, bool wait ){
+  if( gpuSlotEntry[ slot ] < 0 )
+    return true;
+  if( !wait ){
+    GLuint available = 0;
+    glGetQueryObjectuiv( gpuQueries[ slot ], GL_QUERY_RESULT_AVAILABLE, &available );
+    if( !available )
+      return false;
+  }
+  GLuint64 ns = 0;
+  glGetQueryObjectui64v( gpuQueries[ slot ], GL_QUERY_RESULT, &ns );
+  gpuEntries[ gpuSlotEntry[ slot ] ].ns += ns;
+  gpuEntries[ gpuSlotEntry[ slot ] ].calls++;
+  gpuSlotEntry[ slot ] = -1;
+  return true;
+}
+#endif
+
+void gpuProfileBegin( const char* filename, u32 linenum, u32 commandnum ){
+#ifdef __EMSCRIPTEN__
+  gpuProfiling = false;
+#else
+  if( !gpuQueries[ 0 ] ){
+    if( !GLEW_VERSION_3_3 && !GLEW_ARB_timer_query ){
+      print( "%s", "GPU timer queries are not supported, GPU profiling disabled.\n" );
+      gpuProfiling = false;
+      return;
+    }
+    glGenQueries( GPU_QUERY_RING, gpuQueries );
+    for( u32 i = 0; i < GPU_QUERY_RING; ++i )
+      gpuSlotEntry[ i ] = -1;
+  }
+  // If the oldest query is still in flight, skip this dispatch rather than stall.
+  if( !gpuResolve( gpuNext, false ) ){
+    ++gpuDropped;
+    return;
+  }
+  gpuSlotEntry[ gpuNext ] = gpuEntryFor( filename, linenum, commandnum );
+  glBeginQuery( GL_TIME_ELAPSED, gpuQueries[ gpuNext ] );
+  gpuNext = ( gpuNext + 1 ) % GPU_QUERY_RING;
+  gpuActive = true;
+#endif
+}
+
+void gpuProfileEnd( void ){
+#ifndef __EMSCRIPTEN__
+  if( !gpuActive )
+    return;
+  glEndQuery( GL_TIME_ELAPSED );
+  gpuActive = false;
+#endif
+}
+
+void gpuProfileCollect( bool wait ){
+#ifndef __EMSCRIPTEN__
+  if( !gpuQueries[ 0 ] )
+    return;
+  // Oldest first, so a slot that is not ready means the rest are not either.
+  for( u32 i = 0; i < GPU_QUERY_RING; ++i )
+    if( !gpuResolve( ( gpuNext + i ) % GPU_QUERY_RING, wait ) )
+      break;
+#endif
+}
+
+static int compareGpuEntries( const void* a, const void* b ){
+  u64 x = ( *(const gpuEntry* const*)a )->ns;
+  u64 y = ( *(const gpuEntry* const*)b )->ns;
+  return ( x < y ) - ( x > y );
+}
+
+// Returns the entries sorted by time, most expensive first.
+static gpuEntry** gpuSorted( void ){
+  gpuEntry** sorted = mem( gpuEntryCount + 1, gpuEntry* );
+  for( u32 i = 0; i < gpuEntryCount; ++i )
+    sorted[ i ] = gpuEntries + i;
+  qsort( sorted, gpuEntryCount, sizeof( gpuEntry* ), compareGpuEntries );
+  return sorted;
+}
+
+static void gpuProfileReport( u32 count ){
+  gpuProfileCollect( false );
+  if( !gpuEntryCount )
+    return;
+  u64 total = 0;
+  for( u32 i = 0; i < gpuEntryCount; ++i )
+    total += gpuEntries[ i ].ns;
+  f64 percent = total ? 100.0 / (f64)total : 0.0;
+  print( "GPU: %.3f ms in compute dispatches, %llu not timed.\n", total / 1e6, gpuDropped );
+  print( "%10s %8s %10s  %s\n", "ms", "%", "calls", "compute" );
+  gpuEntry** sorted = gpuSorted();
+  for( u32 i = 0; i < gpuEntryCount && i < count; ++i )
+    print( "%10.3f %7.2f%% %10llu  %s:%u command %u\n",
+           sorted[ i ]->ns / 1e6,
+           sorted[ i ]->ns * percent,
+           sorted[ i ]->calls,
+           sorted[ i ]->filename,
+           sorted[ i ]->linenum,
+           sorted[ i ]->commandnum );
+  unmem( sorted );
+}
+
+void gpuProfileWriteJson( FILE* f, u32 frames ){
+  fprintf( f, ",\n  \"gpuComputes\": [" );
+  gpuEntry** sorted = gpuSorted();
+  for( u32 i = 0; i < gpuEntryCount; ++i ){
+    fprintf( f, "%s\n    { \"file\": ", i ? "," : "" );
+    benchWriteString( f, sorted[ i ]->filename );
+    fprintf( f,
+             ", \"line\": %u, \"command\": %u, \"calls\": %llu, \"totalMs\": %.4f, \"msPerFrame\": %.4f }",
+             sorted[ i ]->linenum,
+             sorted[ i ]->commandnum,
+             sorted[ i ]->calls,
+             sorted[ i ]->ns / 1e6,
+             frames ? sorted[ i ]->ns / 1e6 / frames : 0.0 );
+  }
+  fprintf( f, "%s]", gpuEntryCount ? "\n  " : "" );
+  fprintf( f, ",\n  \"gpuUntimedDispatches\": %llu", gpuDropped );
+  unmem( sorted );
+}
+
+static void gpuProfileReset( void ){
+#ifndef __EMSCRIPTEN__
+  if( gpuActive )
+    gpuProfileEnd();
+  if( gpuQueries[ 0 ] ){
+    glDeleteQueries( GPU_QUERY_RING, gpuQueries );
+    memset( gpuQueries, 0, sizeof( gpuQueries ) );
+  }
+#endif
+  for( u32 i = 0; i < gpuEntryCount; ++i )
+    unmem( gpuEntries[ i ].filename );
+  if( gpuEntries )
+    unmem( gpuEntries );
+  gpuEntries = NULL;
+  gpuEntryCount = gpuEntryCapacity = 0;
+  gpuNext = 0;
+  gpuDropped = 0;
+}
+
+static int compareEntries( const void* a, const void* b ){
+  u64 x = ( *(const profileEntry* const*)a )->ticks;
+  u64 y = ( *(const profileEntry* const*)b )->ticks;
+  return ( x < y ) - ( x > y );
+}
+
+static int compareTypes( const void* a, const void* b ){
+  u64 x = typeTicks[ *(const u32*)a ];
+  u64 y = typeTicks[ *(const u32*)b ];
+  return ( x < y ) - ( x > y );
+}
+
+void profileReport( u32 count ){
+  f64 ms = 1000.0 / (f64)SDL_GetPerformanceFrequency();
+  // eval steps include the time of the code they run, so they are left out
+  // of the total to avoid counting it twice.
+  u64 total = 0, calls = 0;
+  for( u32 i = 0; i < STEPTYPECOUNT; ++i )
+    if( i != EVAL ){
+      total += typeTicks[ i ];
+      calls += typeCalls[ i ];
+    }
+  f64 percent = total ? 100.0 / (f64)total : 0.0;
+
+  print( "Profile: %.3f ms in %llu steps.\n", total * ms, calls );
+  print( "%10s %8s %10s  %s\n", "ms", "%", "calls", "location" );
+  profileEntry** sorted = mem( entryCount + 1, profileEntry* );
+  u32 n = 0;
+  for( u32 i = 0; i < entryCapacity; ++i )
+    if( entries[ i ].filename )
+      sorted[ n++ ] = entries + i;
+  qsort( sorted, n, sizeof( profileEntry* ), compareEntries );
+  for( u32 i = 0; i < n && i < count; ++i )
+    print( "%10.3f %7.2f%% %10llu  %s:%u command %u (%s)\n",
+           sorted[ i ]->ticks * ms,
+           sorted[ i ]->ticks * percent,
+           sorted[ i ]->calls,
+           sorted[ i ]->filename,
+           sorted[ i ]->linenum,
+           sorted[ i ]->commandnum,
+           stepTypeNames[ sorted[ i ]->type ] );
+  unmem( sorted );
+
+  print( "%10s %8s %10s  %s\n", "ms", "%", "calls", "type" );
+  u32 types[ STEPTYPECOUNT ];
+  for( u32 i = 0; i < STEPTYPECOUNT; ++i )
+    types[ i ] = i;
+  qsort( types, STEPTYPECOUNT, sizeof( u32 ), compareTypes );
+  for( u32 i = 0; i < STEPTYPECOUNT && i < count && typeCalls[ types[ i ] ]; ++i )
+    print( "%10.3f %7.2f%% %10llu  %s\n",
+           typeTicks[ types[ i ] ] * ms,
+           typeTicks[ types[ i ] ] * percent,
+           typeCalls[ types[ i ] ],
+           stepTypeNames[ types[ i ] ] );
+
+  gpuProfileReport( count );
+}
+
+void profileReset( void ){
+  for( u32 i = 0; i < entryCapacity; ++i )
+    if( entries[ i ].filename )
+      unmem( entries[ i ].filename );
+  if( entries )
+    unmem( entries );
+  entries = NULL;
+  entryCount = entryCapacity = 0;
+  memset( typeTicks, 0, sizeof( typeTicks ) );
+  memset( typeCalls, 0, sizeof( typeCalls ) );
+  gpuProfileReset();
+}
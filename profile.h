@@ -0,0 +1,34 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright © 2025 Jon DuBois. Written with the assistance of GPT-4 et al.   //
+////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef PROFILE_H_INCLUDED
+#define PROFILE_H_INCLUDED
+
+// Per step CPU profiler for runProgram. Time and call counts are accumulated
+// per source location (filename:linenum command commandnum) and per step type.
+// It is started by the profile command or the --profile option.
+extern bool profiling;
+
+void profileStart( void );
+// Adds ticks of SDL_GetPerformanceCounter time to the step's location and type.
+void profileStep( const char* filename, u32 linenum, u32 commandnum, u32 type, u64 ticks );
+// Prints the count most expensive locations and step types.
+void profileReport( u32 count );
+void profileReset( void );
+
+// GPU time of compute dispatches, measured with GL_TIME_ELAPSED queries from a
+// ring so results are read back a few frames late without stalling. Runs
+// whenever the profiler or a benchmark is running. Not available in the
+// browser.
+extern bool gpuProfiling;
+
+void gpuProfileBegin( const char* filename, u32 linenum, u32 commandnum );
+void gpuProfileEnd( void );
+// Reads back finished queries, or all of them if wait is true.
+void gpuProfileCollect( bool wait );
+// Writes ,"gpuComputes": [...] for the benchmark JSON.
+void gpuProfileWriteJson( FILE* f, u32 frames );
+
+#endif //PROFILE_H_INCLUDED
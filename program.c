@@ -20,12 +20,63 @@ EM_JS(void, webgl_getBufferSubData, (GLuint pbo, void* dest, GLsizei size), {
 
 
 
+const char* stepTypeNames[ STEPTYPECOUNT ] = {
+  "INDEX", "SORT", "CLS", "COMPUTE", "CONTINUE", "ADD", "SUB", "MUL", "DIV",
+  "MOD", "POW", "LOG", "SIN", "COS", "FLOOR", "CEIL", "MAX", "MIN", "ATAN",
+  "GREATERTHAN", "EQUALS", "MINMAX", "GLTF", "TOSTRING", "BURY", "RAISE",
+  "BACKFACE", "DEPTH", "ADDITIVE", "IF", "IFN", "TRANSPOSE", "SLICE", "LOAD",
+  "LOADFILE", "EVAL", "FULLSCREEN", "MULTM", "REVERSE", "CAT", "MOVE", "FIRST",
+  "LAST", "ENCLOSE", "EXTRUDE", "UNEXTRUDE", "KEYS", "PRINT", "PRINTLINE",
+  "PRINTSTRING", "KETTLE", "UNKETTLE", "TENSOR", "TEXTBUFFERVIEW", "TOP",
+  "DUP", "ROT", "TRANS", "PROJ", "ORTHO", "LENGTH", "TIME", "TIMEDELTA",
+  "REPEAT", "SHAPE", "RESHAPE", "QUIT", "CALL", "POP", "RETURN", "GAMEPAD",
+  "GAMEPADRUMBLE", "GETINPUT", "TEXTINPUT", "SET", "GET", "TEXTURE",
+  "TEXTUREARRAY", "WINDOWSIZE", "SUM", "WORKSPACE", "TRANSFERSTART",
+  "TRANSFEREND", "IMG", "PROFILE", "GLSTATS"
+};
+
 #define err( ... ) do {                         \
     char* msg = printToString( __VA_ARGS__ );   \
     return msg;                                 \
   }  while( 0 )
 
+// Points dst at the variables of src.
+static void shareVariables( program* dst, const program* src ){
+  dst->vars = src->vars;
+  dst->numVars = src->numVars;
+  dst->varNames = src->varNames;
+  dst->varOffsets = src->varOffsets;
+  dst->varSizes = src->varSizes;
+  dst->varBlock = src->varBlock;
+  dst->bigvars = src->bigvars;
+  dst->numBigvars = src->numBigvars;
+  dst->bigvarNames = src->bigvarNames;
+  dst->bigvarts = src->bigvarts;
+}
+// Leaves an overlay holding only what it added, so it is cleaned up like any
+// other program: the steps and computes copied from its parent are dropped
+// from the front, and the variables are left to the parent.
+static void detachOverlay( program* p ){
+  u32 base = p->parent->numSteps;
+  u32 shared = p->parent->numComputes;
+  memmove( p->steps, p->steps + base, sizeof( step ) * ( p->numSteps - base ) );
+  p->numSteps -= base;
+  memmove( p->computes, p->computes + shared, sizeof( compute* ) * ( p->numComputes - shared ) );
+  p->numComputes -= shared;
+  program none = { 0 };
+  shareVariables( p, &none );
+  p->parent = NULL;
+}
+// Looks label up in p and then in each program it extends.
+static bool findLabel( const program* p, const char* label, u32* value ){
+  for( ; p; p = p->parent )
+    if( trieSearch( p->labels, label, value ) )
+      return true;
+  return false;
+}
 char* finalizeCleanup( program* program, char* block, char* msg ) {
+  if( program->parent )
+    detachOverlay( program );
   if( program->filenames ){
     for( u32 i = 0; i < program->numFilenames; ++i ){
       unmem( program->filenames[ i ] );
@@ -156,101 +207,19 @@ char* finalizeCleanup( program* program, char* block, char* msg ) {
     return finalizeCleanup( p, NULL, msg );     \
   } while( 0 )
 
-void copyProgramState( program* src, program* dst, bool uniforms ){
-  
-  // 1. Copy Small Variables (No changes needed here, just memcpy)
-  for( u32 i = 0; i < dst->numVars; ++i ){
-    char* name = dst->varNames[ i ];
-    u32 srcIndex;
-    if( trieSearch( src->vars, name, &srcIndex ) ){
-      if( src->varSizes[ srcIndex ] != dst->varSizes[ i ] ) continue;
-
-      u32 copySize = (dst->varSizes[i] <= 2) ? 2 : (dst->varSizes[i] <= 4 ? 4 : 16);
-      f32* srcPtr = src->varBlock + src->varOffsets[ srcIndex ];
-      f32* dstPtr = dst->varBlock + dst->varOffsets[ i ];
-      memcpy( dstPtr, srcPtr, copySize * sizeof( f32 ) );
-      if( uniforms ){
-        for( u32 j = 0; j < dst->numComputes; ++j ){
-          glUseProgram( dst->computes[ j ]->program );
-          switch( dst->varSizes[ i ] ){
-          case 1:
-            glUniform1fv( dst->computes[ j ]->uniformLocs[ i ],  1,
-                          dst->varBlock + dst->varOffsets[ i ] );
-            break;
-          case 2:
-            glUniform2fv( dst->computes[ j ]->uniformLocs[ i ],
-                          1,
-                          dst->varBlock + dst->varOffsets[ i ] );
-            break;
-          case 3:
-            glUniform3fv( dst->computes[ j ]->uniformLocs[ i ],
-                          1,
-                          dst->varBlock + dst->varOffsets[ i ] );
-            break;
-          case 4:
-            glUniform4fv( dst->computes[ j ]->uniformLocs[ i ],
-                          1,
-                          dst->varBlock + dst->varOffsets[ i ] );
-            break;
-          case 16:
-            glUniformMatrix4fv( dst->computes[ j ]->uniformLocs[ i ],
-                                1,
-                                GL_TRUE,
-                                dst->varBlock + dst->varOffsets[ i ] );
-            break;
-          }
-        }
-      }
-
-    }
-  }
-
-
-  
-  // 2. Copy Big Variables (Tensors)
-  for( u32 i = 0; i < dst->numBigvars; ++i ){
-    char* name = dst->bigvarNames[ i ];
-    u32 srcIndex;
-
-    if( trieSearch( src->bigvars, name, &srcIndex ) ){
-      if( src->bigvarts[ srcIndex ] ){
-        deleteTensor( dst->bigvarts[ i ] );
-        dst->bigvarts[ i ] = copyTensor( src->bigvarts[ srcIndex ] );
-        takeOwnership( dst->bigvarts[ i ] );
-      }
-    }
-  }
+// The floats a variable of size takes in the uniform block.
+static u32 varSlot( u32 size ){
+  return size <= 2 ? 2 : ( size <= 4 ? 4 : 16 );
 }
-char* preprocessComputeCommands( char* prog ){
-  char* ptr = prog;
-  while( *ptr != '\0' ){
-    if( ptr[ 0 ] == 'c' && ptr[ 1 ] == '\'' &&
-        ( ptr == prog || ptr[ -1 ] == ';' || isspace( ptr[ -1 ] ) ) ){
-      ptr[ 1 ] = '\252';
-      ptr += 2;
-      
-      // Process exactly 4 quoted sections
-      for( int section = 0; section < 4; ++section ){
-        // Replace all ; with \ in this section (until we hit the closing ')
-        while( *ptr != '\0' && *ptr != '\'' ){
-          if( *ptr == '\\' )
-            err( "%s", "Backslash in shader! This is almost certainly an error!" );
-          if( *ptr == ';' )
-            *ptr = '\251';
-          ptr++;
-        }
-        
-        if( *ptr == '\'' ){
-          *ptr = '\252';
-          ptr++;
-        }else 
-          break;
-      }
-    } else {
-      ptr++;
-    }
+// Returns a zeroed block of size bytes starting with the used bytes of a, which
+// it frees.
+static void* growBlock( void* a, size_t used, size_t size ){
+  u8* ret = mem( size, u8 );
+  if( a ){
+    memcpy( ret, a, used );
+    unmem( a );
   }
-  return NULL;
+  return ret;
 }
 void skipWhitespace( const char** str ){
   while( isspace( **str ) )
@@ -427,27 +396,15 @@ static char* parseTensor( const char* command, tensor** ret ){
   t->gpu = false;
   t->ownsData = true;
   t->data = tempData;
+  if( t->size <= TENSOR_INLINE ){
+    memcpy( t->inlineData, tempData, t->size * sizeof( f32 ) );
+    t->data = t->inlineData;
+    unmem( tempData );
+  }
 
   *ret = t; return NULL;
 }
 // Function to remove all '//' comments from the program string
-void removeComments( char* prog ){
-  char* src = prog;
-  char* dst = prog;
-
-  while( *src != '\0' ){
-    if( src[ 0 ] == '/' && src[ 1 ] == '/' ){
-      // Skip characters until the end of the line
-      src += 2;
-      while( *src != '\n' && *src != '\0' ){
-        src++;
-      }
-    } else {
-      *dst++ = *src++;
-    }
-  }
-  *dst = '\0';  // Null-terminate the modified string
-}
 // This adds a compute statement to p and returns its index.
 char* addCompute( const char* filename,
                   u32 linenum,
@@ -521,6 +478,74 @@ void trimWhitespace( char** str ){
   *str = start;
 }
 
+// The commands that are a bare keyword, looked up through a perfect hash built
+// on first use: a seed is searched for under which no two names share a slot,
+// so a lookup is one hash and one compare.
+static const struct{
+  const char* name;
+  u32 type;
+} commandNames[] = {
+  { "img", IMG }, { "load", LOAD }, { "loadFile", LOADFILE }, { "cls", CLS },
+  { "profile", PROFILE }, { "glStats", GLSTATS },
+  { "transferStart", TRANSFERSTART }, { "transferEnd", TRANSFEREND },
+  { "eval", EVAL }, { "first", FIRST }, { "last", LAST }, { "bury", BURY },
+  { "index", INDEX }, { "raise", RAISE }, { "backface", BACKFACE },
+  { "gamepad", GAMEPAD }, { "gamepadRumble", GAMEPADRUMBLE },
+  { "additive", ADDITIVE }, { "depth", DEPTH }, { "unext", UNEXTRUDE },
+  { "len", LENGTH }, { "continue", CONTINUE }, { "kettle", KETTLE },
+  { "unkettle", UNKETTLE }, { "proj", PROJ }, { "ortho", ORTHO },
+  { "translate", TRANS }, { "m", MULTM }, { "keys", KEYS }, { "+", ADD },
+  { "-", SUB }, { "*", MUL }, { "/", DIV }, { "%", MOD }, { "^", POW },
+  { ">", GREATERTHAN }, { "==", EQUALS }, { "sin", SIN }, { "cos", COS },
+  { "min", MIN }, { "max", MAX }, { "floor", FLOOR }, { "atan", ATAN },
+  { "sort", SORT }, { "ceil", CEIL }, { "log", LOG }, { "minmax", MINMAX },
+  { "r", REVERSE }, { "textInput", TEXTINPUT },
+  { "textBufferView", TEXTBUFFERVIEW }, { "timeDelta", TIMEDELTA },
+  { "time", TIME }, { "e", ENCLOSE }, { "fullscreen", FULLSCREEN },
+  { "ext", EXTRUDE }, { "cat", CAT }, { "pop", POP }, { "rep", REPEAT },
+  { "sum", SUM }, { "shape", SHAPE }, { "reshape", RESHAPE }, { "dup", DUP },
+  { "s", SLICE }, { "size", TOP }, { "return", RETURN }, { "rot", ROT },
+  { "input", GETINPUT }, { "windowSize", WINDOWSIZE }, { "t", TRANSPOSE },
+  { "printLine", PRINTLINE }, { "printString", PRINTSTRING }, { "quit", QUIT }
+};
+#define COMMAND_SLOTS 1024
+static u8 commandSlots[ COMMAND_SLOTS ]; // Index into commandNames plus one.
+static u32 commandSeed;
+static u32 commandHash( const char* s, u32 seed ){
+  u32 h = seed;
+  while( *s )
+    h = ( h ^ (u8)*s++ ) * 16777619u;
+  return ( h ^ ( h >> 15 ) ) & ( COMMAND_SLOTS - 1 );
+}
+static void buildCommandHash( void ){
+  u32 count = sizeof( commandNames ) / sizeof( *commandNames );
+  for( u32 seed = 1; seed; ++seed ){
+    memset( commandSlots, 0, sizeof( commandSlots ) );
+    u32 i = 0;
+    for( ; i < count; ++i ){
+      u8* slot = commandSlots + commandHash( commandNames[ i ].name, seed );
+      if( *slot )
+        break;
+      *slot = i + 1;
+    }
+    if( i == count ){
+      commandSeed = seed;
+      return;
+    }
+  }
+  error( "%s", "No perfect hash for the command names." );
+}
+// Sets *type to the step type of a bare keyword command, false if it is not one.
+static bool lookupCommand( const char* command, u32* type ){
+  if( !commandSeed )
+    buildCommandHash();
+  u8 slot = commandSlots[ commandHash( command, commandSeed ) ];
+  if( !slot || strcmp( commandNames[ slot - 1 ].name, command ) )
+    return false;
+  *type = commandNames[ slot - 1 ].type;
+  return true;
+}
+
 char* addStep( program* p, const char* filename, u32 linenum, u32 commandnum, char* command ){
   if( !command )
     return NULL;
@@ -540,7 +565,12 @@ char* addStep( program* p, const char* filename, u32 linenum, u32 commandnum, ch
   curStep->commandnum = commandnum;
   ++p->numSteps;
 
-  if( !strncmp( command, "workspace'", 10 ) ){  // Workspace
+  u32 type;
+  if( lookupCommand( command, &type ) ){
+    curStep->type = type;
+    if( type == LOAD || type == LOADFILE )
+      curStep->progName = NULL;
+  } else if( !strncmp( command, "workspace'", 10 ) ){  // Workspace
     char* starti = command + 10;
     char* endi = starti;
     while( *endi && *endi != '\'' )
@@ -802,8 +832,6 @@ char* addStep( program* p, const char* filename, u32 linenum, u32 commandnum, ch
     if( worklen )
       curStep->branchBaseName = branchName + worklen;
 
-  } else if( !strcmp( command, "img" ) ){
-    curStep->type = IMG;
   } else if( !strncmp( command, "img'", 4 ) ){  // img
     char* starti = command + 4;
     char* endi = starti;
@@ -834,9 +862,6 @@ char* addStep( program* p, const char* filename, u32 linenum, u32 commandnum, ch
     // imgName );
     
      
-  }else if( !strcmp( command, "load" ) ){
-    curStep->type = LOAD;
-    curStep->progName = NULL;    
   }else if( !strncmp( command, "load'", 5 ) ){  // load
     char* starti = command + 5;
     char* endi = starti;
@@ -865,9 +890,6 @@ char* addStep( program* p, const char* filename, u32 linenum, u32 commandnum, ch
     // dbg( "Linenum %u commandnum %u: load %s\n", linenum, commandnum,
     // progName );
 
-  }else if( !strcmp( command, "loadFile" ) ){
-    curStep->type = LOADFILE;
-    curStep->progName = NULL;    
   }else if( !strncmp( command, "loadFile'", 9 ) ){  // loadFile
     char* starti = command + 9;
     char* endi = starti;
@@ -1019,54 +1041,6 @@ char* addStep( program* p, const char* filename, u32 linenum, u32 commandnum, ch
             "Malformed compute statement." );
     }
 
-  } else if( !strcmp( command, "cls" ) ){
-    curStep->type = CLS;
-    // dbg( "Linenum %u commandnum %u: cls\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "transferStart" ) ){
-    curStep->type = TRANSFERSTART;
-    // dbg( "Linenum %u commandnum %u: transferStart\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "transferEnd" ) ){
-    curStep->type = TRANSFEREND;
-    // dbg( "Linenum %u commandnum %u: transferEnd\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "eval" ) ){
-    curStep->type = EVAL;
-    // dbg( "Linenum %u commandnum %u: eval\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "first" ) ){
-    curStep->type = FIRST;
-    // dbg( "Linenum %u commandnum %u: first\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "last" ) ){
-    curStep->type = LAST;
-    // dbg( "Linenum %u commandnum %u: last\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "bury" ) ){
-    curStep->type = BURY;
-    // dbg( "Linenum %u commandnum %u: bury\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "index" ) ){
-    curStep->type = INDEX;
-    // dbg( "Linenum %u commandnum %u: bury\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "raise" ) ){
-    curStep->type = RAISE;
-    // dbg( "Linenum %u commandnum %u: bury\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "backface" ) ){
-    curStep->type = BACKFACE;
-    // dbg( "Linenum %u commandnum %u: backface\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "gamepad" ) ){
-    curStep->type = GAMEPAD;
-    // dbg( "Linenum %u commandnum %u: last\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "gamepadRumble" ) ){
-    curStep->type = GAMEPADRUMBLE;
-    // dbg( "Linenum %u commandnum %u: last\n", linenum, commandnum );
-
   } else if( !strncmp( command, "toString", 8 ) && ( !command[ 8 ] || command[ 8 ] == ' ' ) ){
     curStep->type = TOSTRING;
     curStep->var.size = 4;
@@ -1086,50 +1060,10 @@ char* addStep( program* p, const char* filename, u32 linenum, u32 commandnum, ch
     }
     // dbg( "Linenum %u commandnum %u: toString %s\n", linenum, commandnum,
     // varName );
-  } else if( !strcmp( command, "additive" ) ){
-    curStep->type = ADDITIVE;
-    // dbg( "Linenum %u commandnum %u: additive\n", linenum, commandnum );
-
   } else if( !strncmp( command, "gltf", 4 ) ){ // gltf
     curStep->type = GLTF;
     // dbg( "Linenum %u commandnum %u: gltf\n", linenum, commandnum );
     
-  } else if( !strcmp( command, "depth" ) ){
-    curStep->type = DEPTH;
-    // dbg( "Linenum %u commandnum %u: depth\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "unext" ) ){
-    curStep->type = UNEXTRUDE;
-    // dbg( "Linenum %u commandnum %u: unext\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "len" ) ){
-    curStep->type = LENGTH;
-    // dbg( "Linenum %u commandnum %u: length\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "continue" ) ){
-    curStep->type = CONTINUE;
-    // dbg( "Linenum %u commandnum %u: continue\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "kettle" ) ){
-    curStep->type = KETTLE;
-    // dbg( "Linenum %u commandnum %u: kettle\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "unkettle" ) ){
-    curStep->type = UNKETTLE;
-    // dbg( "Linenum %u commandnum %u: unkettle\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "proj" ) ){
-    curStep->type = PROJ;
-    // dbg( "Linenum %u commandnum %u: proj\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "ortho" ) ){
-    curStep->type = ORTHO;
-    // dbg( "Linenum %u commandnum %u: ortho\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "translate" ) ){
-    curStep->type = TRANS;
-    // dbg( "Linenum %u commandnum %u: translate\n", linenum, commandnum );
-
   } else if( !strncmp( command, "texture", 7 ) && ( !command[ 7 ] || command[ 7 ] == ' ' ) ){
     curStep->type = TEXTURE;
     curStep->var.size = 1;
@@ -1162,174 +1096,6 @@ char* addStep( program* p, const char* filename, u32 linenum, u32 commandnum, ch
     } else
       err3( "%s:%u command %u: %s", filename, linenum, commandnum, "Malformed textureArray statement." );
     
-  } else if( !strcmp( command, "m" ) ){
-    curStep->type = MULTM;
-    // dbg( "Linenum %u commandnum %u: multm\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "keys" ) ){
-    curStep->type = KEYS;
-    // dbg( "Linenum %u commandnum %u: last\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "+" ) ){
-    curStep->type = ADD;
-    // dbg( "Linenum %u commandnum %u: add\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "-" ) ){
-    curStep->type = SUB;
-    // dbg( "Linenum %u commandnum %u: sub\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "*" ) ){
-    curStep->type = MUL;
-    // dbg( "Linenum %u commandnum %u: mul\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "/" ) ){
-    curStep->type = DIV;
-    // dbg( "Linenum %u commandnum %u: div\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "%" ) ){
-    curStep->type = MOD;
-    // dbg( "Linenum %u commandnum %u: mod\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "^" ) ){
-    curStep->type = POW;
-    // dbg( "Linenum %u commandnum %u: exp\n", linenum, commandnum );
-
-  } else if( !strcmp( command, ">" ) ){
-    curStep->type = GREATERTHAN;
-    // dbg( "Linenum %u commandnum %u: greaterThan\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "==" ) ){
-    curStep->type = EQUALS;
-    // dbg( "Linenum %u commandnum %u: equals\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "sin" ) ){
-    curStep->type = SIN;
-    // dbg( "Linenum %u commandnum %u: sin\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "cos" ) ){
-    curStep->type = COS;
-    // dbg( "Linenum %u commandnum %u: cos\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "min" ) ){
-    curStep->type = MIN;
-    // dbg( "Linenum %u commandnum %u: min\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "max" ) ){
-    curStep->type = MAX;
-    // dbg( "Linenum %u commandnum %u: max\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "floor" ) ){
-    curStep->type = FLOOR;
-    // dbg( "Linenum %u commandnum %u: floor\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "atan" ) ){
-    curStep->type = ATAN;
-    // dbg( "Linenum %u commandnum %u: atan\n", linenum, commandnum );
-    
-  } else if( !strcmp( command, "sort" ) ){
-    curStep->type = SORT;
-    // dbg( "Linenum %u commandnum %u: sort\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "ceil" ) ){
-    curStep->type = CEIL;
-    // dbg( "Linenum %u commandnum %u: ceil\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "log" ) ){
-    curStep->type = LOG;
-    // dbg( "Linenum %u commandnum %u: log\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "minmax" ) ){
-    curStep->type = MINMAX;
-    // dbg( "Linenum %u commandnum %u: minmax\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "r" ) ){
-    curStep->type = REVERSE;
-    // dbg( "Linenum %u commandnum %u: reverse\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "textInput" ) ){
-    curStep->type = TEXTINPUT;
-    // dbg( "Linenum %u commandnum %u: textInput\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "textBufferView" ) ){
-    curStep->type = TEXTBUFFERVIEW;
-    // dbg( "Linenum %u commandnum %u: textInput\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "timeDelta" ) ){
-    curStep->type = TIMEDELTA;
-    // dbg( "Linenum %u commandnum %u: timeDelta\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "time" ) ){
-    curStep->type = TIME;
-    // dbg( "Linenum %u commandnum %u: time\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "e" ) ){
-    curStep->type = ENCLOSE;
-    // dbg( "Linenum %u commandnum %u: enclose\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "fullscreen" ) ){
-    curStep->type = FULLSCREEN;
-    // dbg( "Linenum %u commandnum %u: fullscreen\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "ext" ) ){
-    curStep->type = EXTRUDE;
-    // dbg( "Linenum %u commandnum %u: extrude\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "cat" ) ){
-    curStep->type = CAT;
-    // dbg( "Linenum %u commandnum %u: cat\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "pop" ) ){
-    curStep->type = POP;
-    // dbg( "Linenum %u commandnum %u: pop\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "rep" ) ){
-    curStep->type = REPEAT;
-    // dbg( "Linenum %u commandnum %u: repeat\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "sum" ) ){
-    curStep->type = SUM;
-    // dbg( "Linenum %u commandnum %u: sum\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "shape" ) ){
-    curStep->type = SHAPE;
-    // dbg( "Linenum %u commandnum %u: shape\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "reshape" ) ){
-    curStep->type = RESHAPE;
-    // dbg( "Linenum %u commandnum %u: reshape\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "dup" ) ){
-    curStep->type = DUP;
-    // dbg( "Linenum %u commandnum %u: dup\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "s" ) ){
-    curStep->type = SLICE;
-    // dbg( "Linenum %u commandnum %u: slice\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "size" ) ){
-    curStep->type = TOP;
-    // dbg( "Linenum %u commandnum %u: top\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "return" ) ){
-    curStep->type = RETURN;
-    // dbg( "Linenum %u commandnum %u: return\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "rot" ) ){
-    curStep->type = ROT;
-    // dbg( "Linenum %u commandnum %u: rotate\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "input" ) ){
-    curStep->type = GETINPUT;
-    // dbg( "Linenum %u commandnum %u: input\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "windowSize" ) ){
-    curStep->type = WINDOWSIZE;
-    // dbg( "Linenum %u commandnum %u: window size\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "t" ) ){
-    curStep->type = TRANSPOSE;
-    // dbg( "Linenum %u commandnum %u: transpose\n", linenum, commandnum );
-
   } else if( *command == '[' || isfloat( command ) || *command == '\'' ){
     curStep->type = TENSOR;
     if( *command == '\'' ){
@@ -1385,13 +1151,7 @@ char* addStep( program* p, const char* filename, u32 linenum, u32 commandnum, ch
       f32 scalar;
       int charsread;
       if( sscanf( tp, "%f%n", &scalar, &charsread ) == 1 && !tp[ charsread ] ){
-        curStep->tensor = mem( 1, tensor );
-        curStep->tensor->size = 1;
-        for( u32 i = 0; i < 4; ++i )
-          curStep->tensor->shape[ i ] = curStep->tensor->strides[ i ] = 1;
-        curStep->tensor->data = mem( 1, f32 );
-        *curStep->tensor->data = scalar;
-        curStep->tensor->ownsData = true;
+        curStep->tensor = newSmallTensor( 0, NULL, &scalar );
       } else{
         tensor* ret;
         char* imsg = parseTensor( command, &ret );
@@ -1422,18 +1182,6 @@ char* addStep( program* p, const char* filename, u32 linenum, u32 commandnum, ch
     // dbg( "Linenum %u commandnum %u: print %s\n", linenum, commandnum,
     // varName );
    
-  } else if( !strcmp( command, "printLine" ) ){
-    curStep->type = PRINTLINE;
-    // dbg( "Linenum %u commandnum %u: printLine\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "printString" ) ){
-    curStep->type = PRINTSTRING;
-    // dbg( "Linenum %u commandnum %u: printString\n", linenum, commandnum );
-
-  } else if( !strcmp( command, "quit" ) ){
-    curStep->type = QUIT;
-    // dbg( "Linenum %u commandnum %u: quit\n", linenum, commandnum );
-
   } else {  // Call, get or set.
     char* starti = command;
     char* endi = starti;
@@ -1480,146 +1228,714 @@ program* newProgram( void ){
   return ret;
 }
 char* addProgramFromFile( const char* filename, program* program );
-// Modifies prog, adds all steps in prog to program.
-char* addProgram( const char* filename, char* prog, program* program ){
-  removeComments( prog );
-  char* ret = preprocessComputeCommands( prog );
-  if( ret ){
-    finalizeCleanup( program, NULL, ret );
+// Adds one command of a program: an include, or a step.
+static char* addCommand( program* program, const char* filename, u32 linenum, u32 commandnum, char* command ){
+  trimWhitespace( &command );
+  if( strncmp( command, "include'", 8 ) )
+    return addStep( program, filename, linenum, commandnum, command );
+  char* starti = command + 8;
+  char* endi = starti;
+  while( *endi && *endi != '\'' )
+    endi++;
+  if( endi == starti ){
+    char* emsg = printToString( "%s:%u command %u: %s", filename,
+                                linenum,
+                                commandnum,
+                                "Empty include statement." );
+    finalizeCleanup( program, NULL, NULL );
+    return emsg;
+  }
+  if( *endi != '\'' ){
+    char* emsg = printToString( "%s:%u command %u: %s", filename,
+                                linenum,
+                                commandnum,
+                                "Unmatched quote in include statement." );
+    finalizeCleanup( program, NULL, NULL );
+    return emsg;
+  }
+  char* inc = mem( 1 + endi - starti, char );
+  memcpy( inc, starti, endi - starti );
+  inc[ endi - starti ] = '\0';
+  char* ret = addProgramFromFile( inc, program );
+  if( ret )
     return ret;
+  // reset workspace.
+  unmem( workspace );
+  workspace = mem( 1, char );
+  workspace[ 0 ] = 0;
+  program->filenames[ program->numFilenames++ ] = inc;
+  if( program->numFilenames >= NUM_FILENAMES ){
+    finalizeCleanup( program, NULL, NULL );
+    err( "%s", "NUM_FILENAMES exceeded." );
   }
-  
-  char* ptr = prog;
+  return NULL;
+}
+// Modifies prog, adds all steps in prog to program. One pass over prog drops
+// comments, splits it into commands at each unquoted semicolon and hands each
+// to addStep in place, terminated where its semicolon was. The four quoted
+// blocks of a compute get their quotes and semicolons swapped for \252 and
+// \251 on the way, so the split passes over them.
+char* addProgram( const char* filename, char* prog, program* program ){
+  const char* src = prog;
+  char* dst = prog;
+  char* command = prog;
+  char prev = 0;
   u32 linenum = 1;
   u32 commandnum = 0;
+  u32 sections = 0; // Compute blocks left to close.
+  bool inQuote = false, escaped = false;
 
-  while( *ptr != '\0' ){
-    // Remember the start of this chunk.
-    char* oldPtr = ptr;
-
-    // Find the next semicolon (or end-of-string if none).
-    char* semicolon = ptr;
-    bool inQuote = false;
-
-    while( *semicolon != '\0' ){
-      if( *semicolon == '\\' && *(semicolon + 1) ){
-        semicolon += 2; // Skip the escaped character
-      } else if( *semicolon == '\'' ){
-        inQuote = !inQuote;
-      } else if( *semicolon == ';' && !inQuote ){
-        break; // Found the command terminator
-      }
-      semicolon++;
-    }
-    // Calculate length of this “command” chunk
-    size_t cmd_length = semicolon - ptr;
-
-    // If the chunk is empty, check if we are on a newline, then skip
-    if( cmd_length == 0 ){
-      // We still want to count any newlines in the region from oldPtr to semicolon
-      for( char* c = oldPtr; c < semicolon; c++ ){
-        if( *c == '\n' ){
-          linenum++;
-          commandnum = 0;
+  while( true ){
+    char c = *src;
+    if( c == '/' && src[ 1 ] == '/' ){
+      // Skip characters until the end of the line
+      src += 2;
+      while( *src != '\n' && *src != '\0' )
+        src++;
+      continue;
+    }
+    bool end = c == '\0';
+    if( !end ){
+      ++src;
+      // The character after a backslash is taken as is.
+      bool literal = false;
+      if( sections ){
+        if( c == '\\' )
+          return finalizeCleanup( program, NULL,
+                                  printToString( "%s:%u command %u: %s", filename, linenum, commandnum,
+                                                 "Backslash in shader! This is almost certainly an error!" ) );
+        if( c == ';' )
+          c = '\251';
+        else if( c == '\'' ){
+          c = '\252';
+          --sections;
         }
+      } else if( c == 'c' && *src == '\'' &&
+                 ( dst == prog || prev == ';' || isspace( (u8)prev ) ) ){
+        // A compute, c'vertex pre'vertex'pre'fragment' and its counts.
+        *dst++ = prev = c;
+        c = '\252';
+        ++src;
+        sections = 4;
+      } else if( escaped ){
+        literal = true;
+        escaped = false;
+      } else if( c == '\\' )
+        escaped = true;
+      else if( c == '\'' )
+        inQuote = !inQuote;
+      if( c == '\n' ){
+        linenum++;
+        commandnum = 0;
       }
-      // Advance ptr beyond the semicolon if it exists
-      if( *semicolon == ';' ){
-        ptr = semicolon + 1;
-        commandnum++;
-      } else {
-        ptr = semicolon;
+      prev = c;
+      if( c != ';' || inQuote || literal ){
+        *dst++ = c;
+        continue;
       }
-      continue;
+      commandnum++;
     }
+    *dst = '\0';
+    char* ret = addCommand( program, filename, linenum, commandnum, command );
+    if( ret || end )
+      return ret;
+    command = ++dst;
+  }
+}
 
-    // Extract the command into a temporary buffer
-    char* buf = mem( cmd_length + 1, char );
-    strncpy( buf, ptr, cmd_length );
-    buf[ cmd_length ] = '\0';
 
-    // Count newlines in [oldPtr .. semicolon) BEFORE we move ptr.
-    for( char* c = oldPtr; c < semicolon; c++ ){
-      if( *c == '\n' ){
-        linenum++;
-        commandnum = 0;
+// Folds the literal a into the command op after it when op takes a literal
+// operand, so the operand is read in place rather than pushed and popped.
+static void lowerImmediate( instruction* a, u32 op ){
+  const tensor* t = a->tensor;
+  if( t->rank > 1 )
+    return;
+  for( u32 i = 0; i < t->size; ++i )
+    if( t->data[ t->offset + ( t->rank ? t->strides[ 0 ] * i : 0 ) ] < 0.0 )
+      return;
+  if( !t->rank ){
+    a->arg = t->data[ t->offset ];
+    switch( op ){
+    case DUP:
+      a->op = DUPI;
+      break;
+    case RAISE:
+      a->op = RAISEI;
+      break;
+    case BURY:
+      a->op = BURYI;
+      break;
+    case REPEAT:
+      a->op = REPEATI;
+      break;
+    case CAT:
+      a->op = CATI;
+      break;
+    default:
+      break;
+    }
+  } else if( t->rank == 1 && op == SLICE && t->size == 3 ){
+    a->arg = t->data[ t->offset + t->strides[ 0 ] * 2 ];
+    a->op = SLICEI;
+  } else if( t->rank == 1 && op == RESHAPE && t->shape[ 0 ] <= 4 ){
+    a->arg = t->shape[ 0 ];
+    a->op = RESHAPEI;
+  }
+}
+// Lowers the steps into p->code, fusing the common pairs runHot has
+// superinstructions for.
+static void lowerProgram( program* p, const u32* depths ){
+  p->code = mem( p->numSteps + 1, instruction );
+  for( u32 i = 0; i < p->numSteps; ++i ){
+    const step* s = p->steps + i;
+    instruction* in = p->code + i;
+    in->op = s->type;
+    in->depth = depths[ i ] < 255 ? depths[ i ] : 255;
+    switch( s->type ){
+    case IF:
+    case IFN:
+    case CALL:
+      in->arg = s->branch;
+      break;
+    case GET:
+    case SET:
+    case MOVE:
+      in->arg = s->var.index;
+      in->size = s->var.size;
+      break;
+    case COMPUTE:
+      in->arg = s->compute;
+      break;
+    case TENSOR:
+      in->tensor = s->tensor;
+      break;
+    default:
+      break;
+    }
+  }
+  // A cold instruction past the end, so runHot needs no bounds check.
+  p->code[ p->numSteps ].op = QUIT;
+
+  for( u32 i = 0; i + 1 < p->numSteps; ++i ){
+    instruction* a = p->code + i;
+    const instruction* b = a + 1;
+    bool branch = b->op == IF || b->op == IFN;
+    if( a->op == TENSOR && b->op == SET && !b->size )
+      a->op = TENSORSET;
+    else if( a->op == TENSOR && branch && !a->tensor->rank && !a->tensor->gpu ){
+      f32 v = a->tensor->data[ a->tensor->offset ];
+      a->op = ( b->op == IF ? v > 0.0 : v <= 0.0 ) ? JUMP : SKIP;
+    } else if( a->op == GET && branch && !a->size )
+      a->op = b->op == IF ? GETIF : GETIFN;
+    else if( a->op == TENSOR && !a->tensor->gpu )
+      lowerImmediate( a, b->op );
+  }
+}
+// The longest call body, not counting its return, that finalize inlines.
+#define INLINE_MAX 8
+
+// True for the steps after which control does not simply fall through.
+static bool stepIsControl( u32 type ){
+  switch( type ){
+  case IF: case IFN: case CALL: case RETURN: case QUIT: case CONTINUE:
+  case EVAL: case LOAD:
+    return true;
+  default:
+    return false;
+  }
+}
+// The stack effect of the commands that have a fixed one: need is how deep the
+// stack must be for the command to run, and it pops and pushes that many.
+static bool stackEffect( u32 type, u32* need, u32* pops, u32* pushes ){
+  *need = *pops = 0;
+  *pushes = 1;
+  switch( type ){
+  case TENSOR: case GET: case MOVE: case TOP: case TIME: case TIMEDELTA:
+  case WINDOWSIZE: case KEYS: case GETINPUT: case GAMEPAD: case TEXTINPUT:
+    return true;
+  case LOG: case SIN: case COS: case FLOOR: case CEIL: case ATAN: case SHAPE:
+  case LENGTH: case SUM: case FIRST: case LAST: case MINMAX: case ENCLOSE:
+  case EXTRUDE: case UNEXTRUDE: case SORT: case TEXTBUFFERVIEW:
+    *need = *pops = 1;
+    return true;
+  case ADD: case SUB: case MUL: case DIV: case MOD: case POW: case MAX:
+  case MIN: case GREATERTHAN: case EQUALS: case SLICE: case REPEAT:
+  case RESHAPE:
+    *need = *pops = 2;
+    return true;
+  case CAT:
+    *need = *pops = 3;
+    return true;
+  case SET: case POP: case IF: case IFN:
+    *need = *pops = 1;
+    *pushes = 0;
+    return true;
+  // These also need as many below the count as it says, which the immediate
+  // forms check against the depth.
+  case DUP:
+    *need = 2;
+    *pops = 1;
+    return true;
+  case RAISE: case BURY:
+    *need = 2;
+    *pops = 1;
+    *pushes = 0;
+    return true;
+  default:
+    return false;
+  }
+}
+// The number of operands a pure CPU command folds over, or 0 if it does not
+// fold. The result is checked when it is run.
+static u32 foldArity( u32 type ){
+  u32 need, pops, pushes;
+  switch( type ){
+  case LOG: case SIN: case COS: case FLOOR: case CEIL: case ATAN:
+  case ADD: case SUB: case MUL: case DIV: case MOD: case POW: case MAX:
+  case MIN: case GREATERTHAN: case EQUALS: case SLICE: case REPEAT:
+  case RESHAPE: case CAT:
+    stackEffect( type, &need, &pops, &pushes );
+    return pops;
+  default:
+    return 0;
+  }
+}
+static void markLabel( u32* value, void* data ){
+  ( (bool*)data )[ *value ] = true;
+}
+static void remapLabel( u32* value, void* data ){
+  *value = ( (const u32*)data )[ *value ];
+}
+// Marks the steps the labels point to if p has an eval, which can call any of
+// them.
+static void markEvalEntries( const program* p, bool* marks ){
+  for( u32 i = 0; i < p->numSteps; ++i )
+    if( p->steps[ i ].type == EVAL ){
+      trieVisit( p->labels, markLabel, marks );
+      return;
+    }
+}
+// Marks the steps control can land on from anywhere but the step before.
+static bool* branchTargets( const program* p, u32 entry ){
+  bool* ret = mem( p->numSteps + 1, bool );
+  ret[ 0 ] = ret[ entry ] = true;
+  for( u32 i = 0; i < p->numSteps; ++i ){
+    u32 type = p->steps[ i ].type;
+    if( type == IF || type == IFN || type == CALL )
+      ret[ p->steps[ i ].branch ] = true;
+  }
+  markEvalEntries( p, ret );
+  return ret;
+}
+// Drops the dead steps, pointing each branch at a dead step to the next live
+// one, which is where running the dead ones would have ended up.
+static void compactSteps( program* p, const bool* dead, u32* entry ){
+  u32* map = mem( p->numSteps + 1, u32 );
+  u32 n = 0;
+  for( u32 i = 0; i < p->numSteps; ++i ){
+    map[ i ] = n;
+    step* s = p->steps + i;
+    if( !dead[ i ] )
+      p->steps[ n++ ] = *s;
+    else if( s->type == TENSOR )
+      deleteTensor( s->tensor );
+    else if( ( s->type == LOAD || s->type == LOADFILE ) && s->progName )
+      unmem( s->progName );
+  }
+  map[ p->numSteps ] = n;
+  for( u32 i = 0; i < n; ++i ){
+    u32 type = p->steps[ i ].type;
+    if( type == IF || type == IFN || type == CALL )
+      p->steps[ i ].branch = map[ p->steps[ i ].branch ];
+  }
+  *entry = map[ *entry ];
+  trieVisit( p->labels, remapLabel, map );
+  p->numSteps = n;
+  unmem( map );
+}
+// Replaces calls to short straight line functions with a copy of their body.
+static void inlineCalls( program* p, u32* entry ){
+  u32* lengths = mem( p->numSteps, u32 );
+  u32 count = p->numSteps;
+  bool any = false;
+  for( u32 i = 0; i < p->numSteps; ++i ){
+    if( p->steps[ i ].type != CALL )
+      continue;
+    u32 t = p->steps[ i ].branch;
+    u32 len = 0;
+    while( t + len < p->numSteps && len <= INLINE_MAX ){
+      u32 type = p->steps[ t + len ].type;
+      if( stepIsControl( type ) || type == LOADFILE || type == GLTF )
+        break;
+      ++len;
+    }
+    if( len > INLINE_MAX || t + len >= p->numSteps || p->steps[ t + len ].type != RETURN )
+      continue;
+    // Each length counts the return, so a length of 1 is an empty body.
+    lengths[ i ] = len + 1;
+    count = count - 1 + len;
+    any = true;
+  }
+  if( !any ){
+    unmem( lengths );
+    return;
+  }
+  step* steps = mem( count, step );
+  u32* map = mem( p->numSteps + 1, u32 );
+  u32 n = 0;
+  for( u32 i = 0; i < p->numSteps; ++i ){
+    map[ i ] = n;
+    if( !lengths[ i ] ){
+      steps[ n++ ] = p->steps[ i ];
+      continue;
+    }
+    const step* body = p->steps + p->steps[ i ].branch;
+    for( u32 j = 0; j + 1 < lengths[ i ]; ++j ){
+      steps[ n ] = body[ j ];
+      if( body[ j ].type == TENSOR ){
+        steps[ n ].tensor = copyTensor( body[ j ].tensor );
+        keepTensor( steps[ n ].tensor );
       }
+      ++n;
     }
-
-    // Now we can move ptr to the next chunk
-    if( *semicolon == ';' ){
-      ptr = semicolon + 1;  // Skip past the semicolon
-      commandnum++;
-    } else {
-      ptr = semicolon;      // Or end-of-string
+  }
+  map[ p->numSteps ] = n;
+  for( u32 i = 0; i < n; ++i ){
+    u32 type = steps[ i ].type;
+    if( type == IF || type == IFN || type == CALL )
+      steps[ i ].branch = map[ steps[ i ].branch ];
+  }
+  *entry = map[ *entry ];
+  trieVisit( p->labels, remapLabel, map );
+  unmem( p->steps );
+  p->steps = steps;
+  p->numSteps = n;
+  p->stepStackSize = count;
+  unmem( map );
+  unmem( lengths );
+}
+// Runs the pure command at step i over literal operands, returning the result
+// or NULL if it fails or leaves other than one host tensor.
+static tensor* foldStep( program* p, u32 i, tensor** operands, u32 arity ){
+  tensorStack* ts = newStack();
+  for( u32 j = 0; j < arity; ++j ){
+    tensor* t = copyTensor( operands[ j ] );
+    keepTensor( t );
+    push( ts, t );
+  }
+  program one = { 0 };
+  one.steps = p->steps + i;
+  one.numSteps = 1;
+  program* op = &one;
+  bool ret;
+  char* msg = runProgram( ts, &op, 0, &ret );
+  tensor* result = NULL;
+  if( msg )
+    unmem( msg );
+  else if( ts->size == 1 && !ts->stack[ 0 ]->gpu ){
+    result = ts->stack[ 0 ];
+    keepTensor( result );
+    ts->stack[ 0 ] = NULL;
+    ts->size = 0;
+  }
+  deleteStack( ts );
+  return result;
+}
+// One pass of constant folding. Within a block, a get of a variable last set
+// from a literal reads that literal. A pure command whose operands are all
+// literals becomes one literal in the slot of its first operand. Returns true
+// if anything was marked dead.
+static bool foldConstants( program* p, const bool* targets, bool* dead ){
+  tensor** bigvars = mem( p->numBigvars + 1, tensor* );
+  tensor** vars = mem( p->numVars + 1, tensor* );
+  bool changed = false;
+  for( u32 i = 0; i < p->numSteps; ++i ){
+    step* s = p->steps + i;
+    if( targets[ i ] ){
+      memset( bigvars, 0, p->numBigvars * sizeof( tensor* ) );
+      memset( vars, 0, p->numVars * sizeof( tensor* ) );
     }
-
-    // Trim and parse the command, e.g. for “include”, “addStep”, etc.
-    char* command = buf;
-    trimWhitespace( &command );
-    if( !strncmp( command, "include'", 8 ) ){
-      char* starti = command + 8;
-      char* endi = starti;
-      while( *endi && *endi != '\'' )
-        endi++;
-      if( endi == starti ){
-        unmem( buf );
-        char* emsg = printToString( "%s:%u command %u: %s", filename,
-                                    linenum,
-                                    commandnum,
-                                    "Empty include statement." );
-        finalizeCleanup( program, NULL, NULL );
-        return emsg;
+    if( s->type == SET || s->type == MOVE ){
+      tensor* t = NULL;
+      if( s->type == SET && i && !targets[ i ] && p->steps[ i - 1 ].type == TENSOR &&
+          !p->steps[ i - 1 ].tensor->gpu )
+        t = p->steps[ i - 1 ].tensor;
+      if( !s->var.size )
+        bigvars[ s->var.index ] = t;
+      else if( t && s->var.size <= 4 && t->rank == 1 && t->size == s->var.size )
+        vars[ s->var.index ] = t;
+      else
+        vars[ s->var.index ] = NULL;
+      continue;
+    }
+    if( stepIsControl( s->type ) ){
+      memset( bigvars, 0, p->numBigvars * sizeof( tensor* ) );
+      memset( vars, 0, p->numVars * sizeof( tensor* ) );
+      continue;
+    }
+    u32 arity = foldArity( s->type );
+    if( !arity || i < arity )
+      continue;
+    tensor* operands[ 3 ];
+    u32 first = i - arity;
+    bool literal = true;
+    for( u32 j = 0; j < arity && literal; ++j ){
+      const step* o = p->steps + first + j;
+      if( dead[ first + j ] || ( j && targets[ first + j ] ) )
+        literal = false;
+      else if( o->type == TENSOR && !o->tensor->gpu )
+        operands[ j ] = o->tensor;
+      else if( o->type == GET )
+        literal = ( operands[ j ] = o->var.size ? vars[ o->var.index ] : bigvars[ o->var.index ] );
+      else
+        literal = false;
+    }
+    if( !literal || targets[ i ] )
+      continue;
+    tensor* result = foldStep( p, i, operands, arity );
+    if( !result )
+      continue;
+    step* f = p->steps + first;
+    if( f->type == TENSOR )
+      deleteTensor( f->tensor );
+    f->type = TENSOR;
+    f->tensor = result;
+    for( u32 j = first + 1; j <= i; ++j )
+      dead[ j ] = true;
+    changed = true;
+  }
+  unmem( vars );
+  unmem( bigvars );
+  return changed;
+}
+// Marks the steps no path from step 0, entry or a label an eval can call
+// reaches. A literal condition followed by if or ifn only follows the way it
+// goes, and a literal condition that never branches is dropped along with its
+// if.
+static bool dropUnreachable( program* p, const bool* targets, u32 entry, bool* dead ){
+  bool* seen = mem( p->numSteps + 1, bool );
+  bool* roots = mem( p->numSteps + 1, bool );
+  u32* work = mem( 2 * p->numSteps + 2, u32 );
+  u32 n = 0;
+  roots[ 0 ] = roots[ entry ] = true;
+  markEvalEntries( p, roots );
+  for( u32 i = 0; i <= p->numSteps; ++i )
+    if( roots[ i ] )
+      work[ n++ ] = i;
+  while( n ){
+    u32 i = work[ --n ];
+    while( i < p->numSteps && !seen[ i ] ){
+      seen[ i ] = true;
+      const step* s = p->steps + i;
+      if( dead[ i ] ){
+        ++i;
+        continue;
       }
-      if( *endi != '\'' ){
-        unmem( buf );
-        char* emsg = printToString( "%s:%u command %u: %s", filename,
-                                    linenum,
-                                    commandnum,
-                                    "Unmatched quote in include statement." );
-        finalizeCleanup( program, NULL, NULL );
-        return emsg;
+      if( s->type == RETURN || s->type == QUIT || s->type == CONTINUE )
+        break;
+      if( s->type == CALL )
+        work[ n++ ] = s->branch;
+      else if( s->type == IF || s->type == IFN ){
+        const tensor* c = i && !dead[ i - 1 ] && p->steps[ i - 1 ].type == TENSOR ?
+          p->steps[ i - 1 ].tensor : NULL;
+        if( targets[ i ] || !c || c->gpu || c->rank )
+          work[ n++ ] = s->branch;
+        else if( s->type == IF ? c->data[ c->offset ] > 0.0 :
+                 c->data[ c->offset ] <= 0.0 ){
+          i = s->branch;
+          continue;
+        } else
+          dead[ i - 1 ] = dead[ i ] = true;
       }
-      char* inc = mem( 1 + endi - starti, char );
-      memcpy( inc, starti, endi - starti );
-      inc[ endi - starti ] = '\0';
-      char* ret = addProgramFromFile( inc, program );
-      if( ret )
-        return ret;
-      // reset workspace.
-      unmem( workspace );
-      workspace = mem( 1, char );
-      workspace[ 0 ] = 0;
-      program->filenames[ program->numFilenames++ ] = inc;
-      if( program->numFilenames >= NUM_FILENAMES ){
-        unmem( buf );
-        finalizeCleanup( program, NULL, NULL );
-        err( "%s", "NUM_FILENAMES exceeded." );
+      ++i;
+    }
+  }
+  bool changed = false;
+  for( u32 i = 0; i < p->numSteps; ++i )
+    if( !seen[ i ] && !dead[ i ] ){
+      dead[ i ] = true;
+      changed = true;
+    }
+  unmem( work );
+  unmem( roots );
+  unmem( seen );
+  return changed;
+}
+// Optimizes the resolved steps of p, keeping entry pointing at the step it
+// did: inlines short calls, folds constants and drops unreachable steps until
+// nothing changes.
+static void optimizeProgram( program* p, u32* entry ){
+  if( !p->numSteps )
+    return;
+  inlineCalls( p, entry );
+  bool changed = true;
+  while( changed && p->numSteps ){
+    bool* targets = branchTargets( p, *entry );
+    bool* dead = mem( p->numSteps, bool );
+    changed = foldConstants( p, targets, dead );
+    changed = dropUnreachable( p, targets, *entry, dead ) || changed;
+    for( u32 i = 0; i < p->numSteps && !changed; ++i )
+      changed = dead[ i ];
+    if( changed )
+      compactSteps( p, dead, entry );
+    unmem( dead );
+    unmem( targets );
+  }
+}
+// Gets of tensor variables share the payload, so a write to either side copies
+// it. Scanning on from each get to the end of its block: if the variable is set
+// again before anything reads it, the get becomes a move and the value on the
+// stack is left the only owner.
+static void moveVariables( program* p ){
+  for( u32 i = 0; i < p->numSteps; ++i ){
+    step* g = p->steps + i;
+    if( g->type != GET || g->var.size )
+      continue;
+    u32 v = g->var.index;
+    for( u32 j = i + 1; j < p->numSteps; ++j ){
+      const step* s = p->steps + j;
+      if( ( s->type == GET || s->type == SET || s->type == MOVE ) &&
+          !s->var.size && s->var.index == v ){
+        if( s->type == SET ){
+          g->type = MOVE;
+          g->var.wasGet = true;
+        }
+        break;
       }
-      // ... handle 'include' ...
-      // addProgramFromFile(...);
-      unmem( buf );
-    } else {
-      // ... handle everything else ...
-      char* ret = addStep( program, filename, linenum, commandnum, command );
-      unmem( buf );
-      if( ret )
-        return ret;
+      if( stepIsControl( s->type ) )
+        break;
     }
   }
-  return NULL;
 }
+// The passes stackDepths makes before it gives up on a program.
+#define DEPTH_PASSES 256
+#define DEPTH_UNSEEN 0xFFFFFFFFu
+
+// Returns the least stack depth each step can run at along any path from step
+// 0 or entry, or all zeros if it does not settle. The stack carries over from
+// frame to frame, so both start at 0. A call continues at the least depth of
+// the returns its target reaches, and commands with no fixed effect leave the
+// depth unknown.
+static u32* stackDepths( const program* p, u32 entry ){
+  u32 n = p->numSteps;
+  u32* depths = mem( n + 1, u32 );
+  // The returns reachable from each call target without entering a callee,
+  // as a list per target.
+  u32* retFirst = mem( n + 1, u32 );
+  u32* retCount = mem( n + 1, u32 );
+  u32* rets = NULL;
+  u32 numRets = 0, retsSize = 0;
+  u32* stamp = mem( n + 1, u32 );
+  bool* done = mem( n + 1, bool );
+  u32* work = mem( n + 1, u32 );
+  for( u32 c = 0; c < n; ++c ){
+    u32 t = p->steps[ c ].branch;
+    if( p->steps[ c ].type != CALL || done[ t ] )
+      continue;
+    done[ t ] = true;
+    retFirst[ t ] = numRets;
+    u32 w = 0;
+    work[ w++ ] = t;
+    stamp[ t ] = t + 1;
+    while( w ){
+      u32 i = work[ --w ];
+      if( i >= n )
+        continue;
+      u32 type = p->steps[ i ].type;
+      if( type == RETURN ){
+        if( numRets == retsSize ){
+          retsSize = retsSize ? retsSize * 2 : 64;
+          u32* nr = mem( retsSize, u32 );
+          if( rets ){
+            memcpy( nr, rets, numRets * sizeof( u32 ) );
+            unmem( rets );
+          }
+          rets = nr;
+        }
+        rets[ numRets++ ] = i;
+        continue;
+      }
+      if( type == QUIT || type == CONTINUE )
+        continue;
+      if( ( type == IF || type == IFN ) && stamp[ p->steps[ i ].branch ] != t + 1 ){
+        stamp[ p->steps[ i ].branch ] = t + 1;
+        work[ w++ ] = p->steps[ i ].branch;
+      }
+      if( stamp[ i + 1 ] != t + 1 ){
+        stamp[ i + 1 ] = t + 1;
+        work[ w++ ] = i + 1;
+      }
+    }
+    retCount[ t ] = numRets - retFirst[ t ];
+  }
 
-
-char* finalize( program* program ){
+  for( u32 i = 0; i <= n; ++i )
+    depths[ i ] = DEPTH_UNSEEN;
+  depths[ 0 ] = depths[ entry ] = 0;
+  bool changed = true;
+  u32 pass = 0;
+  for( ; changed && pass < DEPTH_PASSES; ++pass ){
+    changed = false;
+    for( u32 i = 0; i < n; ++i ){
+      u32 d = depths[ i ];
+      if( d == DEPTH_UNSEEN )
+        continue;
+      const step* s = p->steps + i;
+      u32 need, pops, pushes, out = 0, next = i + 1;
+      if( s->type == RETURN || s->type == QUIT || s->type == CONTINUE )
+        continue;
+      if( s->type == CALL ){
+        if( d < depths[ s->branch ] ){
+          depths[ s->branch ] = d;
+          changed = true;
+        }
+        out = DEPTH_UNSEEN;
+        for( u32 r = 0; r < retCount[ s->branch ]; ++r ){
+          u32 rd = depths[ rets[ retFirst[ s->branch ] + r ] ];
+          if( rd < out )
+            out = rd;
+        }
+      } else if( stackEffect( s->type, &need, &pops, &pushes ) )
+        out = ( d >= pops ? d - pops : 0 ) + pushes;
+      if( s->type == IF || s->type == IFN ){
+        if( out < depths[ s->branch ] ){
+          depths[ s->branch ] = out;
+          changed = true;
+        }
+      }
+      if( out < depths[ next ] ){
+        depths[ next ] = out;
+        changed = true;
+      }
+    }
+  }
+  if( changed )
+    memset( depths, 0, ( n + 1 ) * sizeof( u32 ) );
+  else
+    for( u32 i = 0; i <= n; ++i )
+      if( depths[ i ] == DEPTH_UNSEEN )
+        depths[ i ] = 0;
+  unmem( work );
+  unmem( done );
+  unmem( stamp );
+  if( rets )
+    unmem( rets );
+  unmem( retCount );
+  unmem( retFirst );
+  return depths;
+}
+// Resolves and optimizes the steps of program. entry is the step execution
+// starts at, and is updated to where that step ends up. For an overlay only the
+// steps it added are resolved, and its variables are added to the storage it
+// shares.
+char* finalize( program* program, u32* entry ){
+  u32 base = program->parent ? program->parent->numSteps : 0;
   // Collect variables and craft the uniform block and the program vars.
   char* glslUniformBlock = NULL;
   {
-    program->numVars = 0;
-    u32 nameslen = 0;
     u32 baselen = strlen( "uniform float %s;" ) + 30;
     // Check here for calls that are sets
-    for( u32 i = 0; i < program->numSteps; ++i ){
+    for( u32 i = base; i < program->numSteps; ++i ){
       if( program->steps[ i ].type == CALL ){
         u32 len = strlen( program->steps[ i ].branchName );
         s64 back = len - 1;
@@ -1654,27 +1970,59 @@ char* finalize( program* program ){
         }
       }
     }    
-    for( u32 i = 0; i < program->numSteps; ++i )
-      if( program->steps[ i ].type == SET ){
-        if( program->steps[ i ].var.size ){
-          nameslen += strlen( program->steps[ i ].var.name ) + 2;
-          program->numVars++;
-        }else
-          program->numBigvars++;
+    // Check the sizes before adding anything, so a failed eval leaves the
+    // variables as they were.
+    u32 sets = 0, bigsets = 0;
+    trieNode* sizes = newTrieNode( NULL, 0 );
+    for( u32 i = base; i < program->numSteps; ++i ){
+      step* s = program->steps + i;
+      if( s->type != SET )
+        continue;
+      if( !s->var.size ){
+        ++bigsets;
+        continue;
       }
-    program->varOffsets = mem( program->numVars, u32 );
-    program->varSizes = mem( program->numVars, u32 );
-    u32 bufsize = baselen * program->numVars + nameslen + 200;
-    glslUniformBlock = mem( bufsize, u8 );
-    char* p = glslUniformBlock;
-    //    p += snprintf( p, bufsize - ( p - glslUniformBlock ), "layout(std140)
-    //    uniform vars{\n" );
-    program->varNames = mem( program->numVars, char* );
-    program->bigvarNames = mem( program->numBigvars, char* );
-    program->numVars = 0;
-    program->numBigvars = 0;
-    u32 offset = 0;
-    for( u32 i = 0; i < program->numSteps; ++i ){
+      ++sets;
+      u32 val, size = s->var.size;
+      if( trieSearch( program->vars, s->var.name, &val ) )
+        size = program->varSizes[ val ];
+      else if( !trieSearch( sizes, s->var.name, &size ) )
+        trieInsert( sizes, s->var.name, size );
+      if( size != s->var.size ){
+        deleteTrieNode( sizes );
+        for( u32 j = base; j < program->numSteps; ++j )
+          if( program->steps[ j ].type == SET ){
+            unmem( program->steps[ j ].var.name );
+            program->steps[ j ].var.name = NULL;
+          }
+        err2( "%s:%u command %u: %s", s->filename,
+              s->linenum,
+              s->commandnum,
+              "Incorrect size setting already set value. Size is static." );
+      }
+    }
+    deleteTrieNode( sizes );
+
+    u32 oldVars = program->numVars;
+    u32 oldBigvars = program->numBigvars;
+    u32 oldOffset = oldVars ?
+      program->varOffsets[ oldVars - 1 ] + varSlot( program->varSizes[ oldVars - 1 ] ) : 0;
+    u32 offset = oldOffset;
+    if( sets ){
+      program->varOffsets = growBlock( program->varOffsets, sizeof( u32 ) * oldVars,
+                                       sizeof( u32 ) * ( oldVars + sets ) );
+      program->varSizes = growBlock( program->varSizes, sizeof( u32 ) * oldVars,
+                                     sizeof( u32 ) * ( oldVars + sets ) );
+      program->varNames = growBlock( program->varNames, sizeof( char* ) * oldVars,
+                                     sizeof( char* ) * ( oldVars + sets ) );
+    }
+    if( bigsets ){
+      program->bigvarNames = growBlock( program->bigvarNames, sizeof( char* ) * oldBigvars,
+                                        sizeof( char* ) * ( oldBigvars + bigsets ) );
+      program->bigvarts = growBlock( program->bigvarts, sizeof( tensor* ) * oldBigvars,
+                                     sizeof( tensor* ) * ( oldBigvars + bigsets ) );
+    }
+    for( u32 i = base; i < program->numSteps; ++i ){
       if( program->steps[ i ].type == SET ){
         if( !program->steps[ i ].var.size ){
           u32 val;
@@ -1691,100 +2039,102 @@ char* finalize( program* program ){
         }else{
           u32 val;
           if( trieSearch( program->vars, program->steps[ i ].var.name, &val ) ){
-            if( program->steps[ i ].var.size != program->varSizes[ val ] )
-              err2( "%s:%u command %u: %s", program->steps[ i ].filename,
-                    program->steps[ i ].linenum,
-                    program->steps[ i ].commandnum,
-                    "Incorrect size setting already set value. Size is static." );
             unmem( program->steps[ i ].var.name );
             program->steps[ i ].var.name = NULL;
             program->steps[ i ].var.index = val;
           } else {
-            u32 varlen = strlen( program->steps[ i ].var.name );
-            char* safeName = mem( varlen + 1, char );
-            memcpy( safeName, program->steps[ i ].var.name, varlen + 1 );
-            for( u32 i = 0; i < varlen; ++i )
-              if( safeName[ i ] == '.' )
-                safeName[ i ] = '_';
             trieInsert( program->vars, program->steps[ i ].var.name, program->numVars );
-            switch( program->steps[ i ].var.size ){
-            case 1:
-              p += snprintf( p,
-                             bufsize - ( p - glslUniformBlock ),
-                             "uniform float %s;\n",
-                             safeName );
-              break;
-            case 2:
-              p += snprintf( p,
-                             bufsize - ( p - glslUniformBlock ),
-                             "uniform vec2 %s;\n",
-                             safeName );
-              break;
-            case 3:
-              p += snprintf( p,
-                             bufsize - ( p - glslUniformBlock ),
-                             "uniform vec3 %s;\n",
-                             safeName );
-              break;
-            case 4:
-              p += snprintf( p,
-                             bufsize - ( p - glslUniformBlock ),
-                             "uniform vec4 %s;\n",
-                             safeName );
-              break;
-            case 16:
-              p += snprintf( p,
-                             bufsize - ( p - glslUniformBlock ),
-                             "uniform mat4 %s;\n",
-                             safeName );
-              break;
-            default:
-              err2( "%s", "Logic error in Atlas!" );
-            }
-            unmem( safeName );
             program->varNames[ program->numVars ] = program->steps[ i ].var.name;
             program->varOffsets[ program->numVars ] = offset;
             program->varSizes[ program->numVars ] = program->steps[ i ].var.size;
-            if( program->steps[ i ].var.size == 1 || program->steps[ i ].var.size == 2 )
-              offset += 2;
-            else if( program->steps[ i ].var.size == 3 ||
-                     program->steps[ i ].var.size == 4 )
-              offset += 4;
-            else
-              offset += 16;
+            offset += varSlot( program->steps[ i ].var.size );
             program->steps[ i ].var.index = program->numVars;
             ++program->numVars;
           }
         }
       }
     }
-
-    // p += snprintf( p, bufsize - ( p - glslUniformBlock ), "};\n" );
-    program->varBlock = mem( offset, f32 );
-    program->bigvarts = mem( program->numBigvars, tensor* );
+    if( offset > oldOffset )
+      program->varBlock = growBlock( program->varBlock, sizeof( f32 ) * oldOffset,
+                                     sizeof( f32 ) * offset );
     // populate bigvarts with scalar 0s.
-    for( u32 i = 0; i < program->numBigvars; ++i ){
-      f32* nt = mem( 1, f32 );
-      program->bigvarts[ i ] = newTensor( 0, NULL, nt );;
+    for( u32 i = oldBigvars; i < program->numBigvars; ++i ){
+      f32 zero = 0.0;
+      program->bigvarts[ i ] = newSmallTensor( 0, NULL, &zero );
+    }
+    // The computes already built have no uniform for the new variables.
+    if( program->numVars > oldVars )
+      for( u32 i = 0; i < program->numComputes; ++i ){
+        compute* c = program->computes[ i ];
+        if( c->build )
+          continue;
+        c->uniformLocs = growBlock( c->uniformLocs, sizeof( GLuint ) * oldVars,
+                                    sizeof( GLuint ) * program->numVars );
+        for( u32 j = oldVars; j < program->numVars; ++j )
+          c->uniformLocs[ j ] = -1;
+      }
+    for( struct program* q = program->parent; q; q = q->parent )
+      shareVariables( q, program );
+
+    u32 bufsize = 200;
+    for( u32 i = 0; i < program->numVars; ++i )
+      bufsize += baselen + strlen( program->varNames[ i ] ) + 2;
+    glslUniformBlock = mem( bufsize, u8 );
+    char* p = glslUniformBlock;
+    for( u32 i = 0; i < program->numVars; ++i ){
+      u32 varlen = strlen( program->varNames[ i ] );
+      char* safeName = mem( varlen + 1, char );
+      memcpy( safeName, program->varNames[ i ], varlen + 1 );
+      for( u32 i = 0; i < varlen; ++i )
+        if( safeName[ i ] == '.' )
+          safeName[ i ] = '_';
+      switch( program->varSizes[ i ] ){
+      case 1:
+        p += snprintf( p,
+                       bufsize - ( p - glslUniformBlock ),
+                       "uniform float %s;\n",
+                       safeName );
+        break;
+      case 2:
+        p += snprintf( p,
+                       bufsize - ( p - glslUniformBlock ),
+                       "uniform vec2 %s;\n",
+                       safeName );
+        break;
+      case 3:
+        p += snprintf( p,
+                       bufsize - ( p - glslUniformBlock ),
+                       "uniform vec3 %s;\n",
+                       safeName );
+        break;
+      case 4:
+        p += snprintf( p,
+                       bufsize - ( p - glslUniformBlock ),
+                       "uniform vec4 %s;\n",
+                       safeName );
+        break;
+      case 16:
+        p += snprintf( p,
+                       bufsize - ( p - glslUniformBlock ),
+                       "uniform mat4 %s;\n",
+                       safeName );
+        break;
+      default:
+        unmem( safeName );
+        err2( "%s", "Logic error in Atlas!" );
+      }
+      unmem( safeName );
     }
-      
-    // glGenBuffers( 1, &program->ubo );
-    // glBindBuffer( GL_UNIFORM_BUFFER, program->ubo );
-    // glBufferData( GL_UNIFORM_BUFFER, sizeof( f32 ) * offset, program->varBlock,
-    // GL_DYNAMIC_DRAW ); glBindBufferBase( GL_UNIFORM_BUFFER, 0, program->ubo );
-    // glBindBuffer( GL_UNIFORM_BUFFER, 0 );
-    // glBindBufferBase( GL_UNIFORM_BUFFER, 0, 0 );
-    // dbg( "Block %s, totsize %u", glslUniformBlock, offset );
   }
 
   // Second pass for ifs, ifns, calls, computes, and gets.
-  for( u32 i = 0; i < program->numSteps; ++i )
+  for( u32 i = base; i < program->numSteps; ++i )
     if( program->steps[ i ].type == IF || program->steps[ i ].type == IFN ||
         program->steps[ i ].type == CALL ){
       u32 jumpTo;
 
-      if( !trieSearch( program->labels, program->steps[ i ].branchName, &jumpTo )
-          && !trieSearch( program->labels, program->steps[ i ].branchBaseName, &jumpTo ) ){
+      if( !findLabel( program, program->steps[ i ].branchName, &jumpTo )
+          && !findLabel( program, program->steps[ i ].branchBaseName, &jumpTo ) ){
         if( program->steps[ i ].type == CALL ){
           u32 vi;
           char* tp = program->steps[ i ].branchName;
@@ -1898,10 +2248,38 @@ char* finalize( program* program ){
       program->steps[ i ].toCompute.vglslpre = NULL;
     }
   unmem( glslUniformBlock );
+  u32* depths;
+  if( program->parent )
+    // An eval runs once, so it is not worth optimizing, and the depths proven
+    // for its parent need not hold when called from it, so none are assumed.
+    depths = mem( program->numSteps + 1, u32 );
+  else{
+    optimizeProgram( program, entry );
+    moveVariables( program );
+    depths = stackDepths( program, *entry );
+  }
+  lowerProgram( program, depths );
+  unmem( depths );
   return NULL;
 }
+// Opens a file named by a script. The shipped scripts spell paths the Windows
+// way, inc\stdlib.atl, so POSIX builds turn backslashes into slashes first. The
+// browser build preloads its files under those very names and leaves them be.
+FILE* openFile( const char* filename, const char* mode ){
+#if defined( _WIN32 ) || defined( __EMSCRIPTEN__ )
+  return fopen( filename, mode );
+#else
+  char* path = printToString( "%s", filename );
+  for( char* c = path; *c; ++c )
+    if( *c == '\\' )
+      *c = '/';
+  FILE* ret = fopen( path, mode );
+  unmem( path );
+  return ret;
+#endif
+}
 bool fileExists( const char *filename ){
-  FILE *file = fopen( filename, "rb" );
+  FILE *file = openFile( filename, "rb" );
   if( file ){
     fclose( file );
     return 1;
@@ -1909,7 +2287,7 @@ bool fileExists( const char *filename ){
   return 0;
 }
 char* addProgramFromFile( const char* filename, program* program ){
-  FILE* file = fopen( filename, "rb" );
+  FILE* file = openFile( filename, "rb" );
 
   if( !file )
     err( "%s %s.", "Failed to open file", filename );
@@ -1951,15 +2329,12 @@ char* newProgramFromFile( const char* filename, program** ret ){
     deleteProgram( prog );
     return err;
   }
-  err = finalize( prog );
+  u32 entry = 0;
+  err = finalize( prog, &entry );
   if( err ){
     deleteProgram( prog );
     return err;
   }
-  
-  u32 len = strlen( filename );
-  prog->mainFilename = mem( len + 1, char );
-  strcpy( prog->mainFilename, filename );
 
   // Reset afterwards too.
   unmem( workspace );
@@ -1967,41 +2342,36 @@ char* newProgramFromFile( const char* filename, program** ret ){
   workspace[ 0 ] = 0;
   *ret = prog; return NULL;
 }
-char* copyProgramWithEval( program* p, const char* eval, u32* startStep, program** ret ){
+char* newProgramWithEval( program* p, char* eval, u32* startStep, program** ret ){
   char* tw = workspace;
   workspace = mem( 1, char );
   workspace[ 0 ] = 0;
 
-  program* newProg = newProgram();
+  program* newProg = mem( 1, program );
+  newProg->parent = p;
+  newProg->stepStackSize = p->numSteps + initSize;
+  newProg->steps = mem( newProg->stepStackSize, step );
+  memcpy( newProg->steps, p->steps, sizeof( step ) * p->numSteps );
+  newProg->numSteps = p->numSteps;
+  // An eval that fails carries on, and a variable moved out of before the set
+  // that was meant to follow would be left 0, so the eval's copy gets instead.
+  for( u32 i = 0; i < newProg->numSteps; ++i )
+    if( newProg->steps[ i ].type == MOVE && newProg->steps[ i ].var.wasGet )
+      newProg->steps[ i ].type = GET;
+  newProg->computeStackSize = p->numComputes + initSize;
+  newProg->computes = mem( newProg->computeStackSize, compute* );
+  memcpy( newProg->computes, p->computes, sizeof( compute* ) * p->numComputes );
+  newProg->numComputes = p->numComputes;
+  newProg->labels = newTrieNode( NULL, 0 );
+  shareVariables( newProg, p );
+  newProg->returns = mem( initSize, u32 );
+  newProg->returnStackSize = initSize;
+  newProg->filenames = mem( NUM_FILENAMES, char* );
 
-  if( p->mainFilename ){
-    char* emsg = addProgramFromFile( p->mainFilename, newProg );
-    if( emsg ){
-      unmem( workspace );
-      workspace = tw;
-      return emsg;
-    }
-  }
-
-  unmem( workspace );
-  workspace = mem( 1, char );
-  workspace[ 0 ] = 0;
-  
   *startStep = newProg->numSteps;
-
-  char* err = addProgram( "{EVAL}", (char*)eval, newProg );
-  if( err ){
-    unmem( workspace );
-    workspace = tw;
-    deleteProgram( newProg );
-    return err;
-  }
-  
-  unmem( workspace );
-  workspace = mem( 1, char );
-  workspace[ 0 ] = 0;
-
-  err = finalize( newProg );
+  char* err = addProgram( "{EVAL}", eval, newProg );
+  if( !err )
+    err = finalize( newProg, startStep );
   unmem( workspace );
   workspace = tw;
   if( err ){
@@ -2009,9 +2379,10 @@ char* copyProgramWithEval( program* p, const char* eval, u32* startStep, program
     return err;
   }
   *ret = newProg; return NULL;
-} 
-
+}
 void deleteProgram( program* p ){
+  if( p->parent )
+    detachOverlay( p );
   for( u32 i = 0; i < p->numComputes; ++i )
     deleteCompute( p->computes[ i ] );
   for( u32 i = 0; i < p->numSteps; ++i ){
@@ -2058,8 +2429,8 @@ void deleteProgram( program* p ){
     unmem( p->computes );
   if( p->steps )
     unmem( p->steps );
-  if( p->mainFilename )
-    unmem( p->mainFilename );
+  if( p->code )
+    unmem( p->code );
   unmem( p );
 }
 static f32* compareArray = NULL;
@@ -2068,13 +2439,290 @@ int compareFloats(const void *a, const void *b) {
   u32 fb = *(const f32 *)b;
   return (compareArray[ fa ] > compareArray[ fb ]) - (compareArray[ fa ] < compareArray[ fb ] );
 }
-// A pointer pointer because program might change during e.g. a load.
-char* runProgram( tensorStack* ts, program** progp, u32 startstep, bool* ret ){
+// Returns a new tensor holding variable index of the given size: a copy
+// sharing a tensor variable's payload, or a view of the uniform block. NULL for
+// a bad size.
+static tensor* getVariable( program* p, u32 index, u32 size ){
+  if( !size )
+    return copyTensor( p->bigvarts[ index ] );
+  static const u32 shape1[ 4 ] = { 1 };
+  static const u32 shape2[ 4 ] = { 2 };
+  static const u32 shape3[ 4 ] = { 3 };
+  static const u32 shape4[ 4 ] = { 4 };
+  static const u32 shape16[ 2 ] = { 4, 4 };
+  const u32* shape;
+  u32 rank = 1;
+  switch( p->varSizes[ index ] ){
+  case 1:
+    shape = shape1;
+    break;
+  case 2:
+    shape = shape2;
+    break;
+  case 3:
+    shape = shape3;
+    break;
+  case 4:
+    shape = shape4;
+    break;
+  case 16:
+    shape = shape16;
+    rank = 2;
+    break;
+  default:
+    return NULL;
+  }
+  tensor* t = newTensor( rank, shape, p->varBlock + p->varOffsets[ index ] );
+  t->ownsData = false;  // Ensure the tensor does not own the data
+  return t;
+}
+
+// Moves the tensor raise below the top of the stack to the top.
+static void raiseTensor( tensorStack* ts, u32 raise ){
+  tensor* tr = ts->stack[ ( ts->size - 1 ) - raise ];
+  for( u32 i = ( ts->size - 1 ) - raise; i < ts->size - 1; ++i )
+    ts->stack[ i ] = ts->stack[ i + 1 ];
+  ts->stack[ ts->size - 1 ] = tr;
+}
+// Moves the top of the stack bury places down.
+static void buryTensor( tensorStack* ts, u32 bury ){
+  tensor* tb = ts->stack[ ts->size - 1 ];
+  for( u32 i = ts->size - 1; i > ( ts->size - 1 ) - bury; --i )
+    ts->stack[ i ] = ts->stack[ i - 1 ];
+  ts->stack[ ( ts->size - 1 ) - bury ] = tb;
+}
+
+// Runs p->code from *ip for as long as the instructions are hot and on their
+// fast path, and leaves *ip at the first one that is not. runProgram runs that
+// one from the cold table, which also reports any error, so a handler only has
+// to bail unless it fails part way. A stack check is skipped where finalize
+// proved the depth. Threaded through computed gotos where the compiler has
+// them.
+#ifdef __GNUC__
+#define HOT( op ) hot##op
+#define DISPATCH() goto *hot[ code[ i ].op ]
+#else
+#define HOT( op ) case op
+#define DISPATCH() goto dispatch
+#endif
+static char* runHot( tensorStack* ts, program* p, u32* ip ){
+  const instruction* code = p->code;
+  u32 i = *ip;
+#ifdef __GNUC__
+  static void* const hot[ INSTRUCTIONCOUNT ] = {
+    [ 0 ... INSTRUCTIONCOUNT - 1 ] = &&cold,
+    [ TENSOR ] = &&hotTENSOR,
+    [ POP ] = &&hotPOP,
+    [ GET ] = &&hotGET,
+    [ SET ] = &&hotSET,
+    [ IF ] = &&hotIF,
+    [ IFN ] = &&hotIFN,
+    [ CALL ] = &&hotCALL,
+    [ RETURN ] = &&hotRETURN,
+    [ TENSORSET ] = &&hotTENSORSET,
+    [ GETIF ] = &&hotGETIF,
+    [ GETIFN ] = &&hotGETIFN,
+    [ JUMP ] = &&hotJUMP,
+    [ SKIP ] = &&hotSKIP,
+    [ DUPI ] = &&hotDUPI,
+    [ RAISEI ] = &&hotRAISEI,
+    [ BURYI ] = &&hotBURYI,
+    [ REPEATI ] = &&hotREPEATI,
+    [ SLICEI ] = &&hotSLICEI,
+    [ CATI ] = &&hotCATI,
+    [ RESHAPEI ] = &&hotRESHAPEI
+  };
+  DISPATCH();
+  {
+#else
+ dispatch:
+  switch( code[ i ].op ){
+  default:
+#endif
+  cold:
+    *ip = i;
+    return NULL;
+  HOT( TENSOR ):
+    push( ts, copyTensor( code[ i ].tensor ) );
+    ++i;
+    DISPATCH();
+  HOT( POP ):
+    pop( ts );
+    ++i;
+    DISPATCH();
+  HOT( GET ): {
+    tensor* t = getVariable( p, code[ i ].arg, code[ i ].size );
+    if( !t )
+      goto cold;
+    push( ts, t );
+    ++i;
+    DISPATCH();
+  }
+  HOT( SET ): {
+    if( code[ i ].size || ( !code[ i ].depth && !ts->size ) )
+      goto cold;
+    u32 v = code[ i ].arg;
+    if( p->bigvarts[ v ] )
+      deleteTensor( p->bigvarts[ v ] );
+    p->bigvarts[ v ] = ts->stack[ ts->size - 1 ];
+    ts->stack[ --ts->size ] = NULL;
+    keepTensor( p->bigvarts[ v ] );
+    ++i;
+    DISPATCH();
+  }
+  HOT( IF ):
+  HOT( IFN ): {
+    if( !code[ i ].depth && !ts->size )
+      goto cold;
+    const tensor* t = ts->stack[ ts->size - 1 ];
+    if( t->rank || t->gpu )
+      goto cold;
+    f32 v = t->data[ t->offset ];
+    bool cond = code[ i ].op == IF ? v > 0.0 : v <= 0.0;
+    pop( ts );
+    i = cond ? code[ i ].arg : i + 1;
+    DISPATCH();
+  }
+  HOT( CALL ):
+    if( p->numReturns >= p->returnStackSize )
+      goto cold;
+    p->returns[ p->numReturns++ ] = i;
+    i = code[ i ].arg;
+    DISPATCH();
+  HOT( RETURN ):
+    if( !p->numReturns )
+      goto cold;
+    i = p->returns[ --p->numReturns ] + 1;
+    DISPATCH();
+  HOT( TENSORSET ): {
+    u32 v = code[ i + 1 ].arg;
+    if( p->bigvarts[ v ] )
+      deleteTensor( p->bigvarts[ v ] );
+    p->bigvarts[ v ] = copyTensor( code[ i ].tensor );
+    keepTensor( p->bigvarts[ v ] );
+    i += 2;
+    DISPATCH();
+  }
+  HOT( GETIF ):
+  HOT( GETIFN ): {
+    const tensor* t = p->bigvarts[ code[ i ].arg ];
+    if( !t || t->rank || t->gpu )
+      goto cold;
+    f32 v = t->data[ t->offset ];
+    bool cond = code[ i ].op == GETIF ? v > 0.0 : v <= 0.0;
+    i = cond ? code[ i + 1 ].arg : i + 2;
+    DISPATCH();
+  }
+  HOT( JUMP ):
+    i = code[ i + 1 ].arg;
+    DISPATCH();
+  HOT( SKIP ):
+    i += 2;
+    DISPATCH();
+  HOT( DUPI ):
+    if( code[ i ].arg >= code[ i ].depth && code[ i ].arg >= ts->size )
+      goto cold;
+    push( ts, copyTensor( ts->stack[ ( ts->size - 1 ) - code[ i ].arg ] ) );
+    i += 2;
+    DISPATCH();
+  HOT( RAISEI ):
+    if( code[ i ].arg >= code[ i ].depth && code[ i ].arg >= ts->size )
+      goto cold;
+    raiseTensor( ts, code[ i ].arg );
+    i += 2;
+    DISPATCH();
+  HOT( BURYI ):
+    if( code[ i ].arg >= code[ i ].depth && code[ i ].arg >= ts->size )
+      goto cold;
+    buryTensor( ts, code[ i ].arg );
+    i += 2;
+    DISPATCH();
+  HOT( REPEATI ): {
+    if( !code[ i ].depth && !ts->size )
+      goto cold;
+    char* emsg = tensorRepeat( ts, ts->size - 1, code[ i ].arg );
+    if( emsg )
+      return emsg;
+    i += 2;
+    DISPATCH();
+  }
+  HOT( SLICEI ): {
+    if( !code[ i ].depth && !ts->size )
+      goto cold;
+    const tensor* t = code[ i ].tensor;
+    u32 start = t->data[ t->offset ];
+    u32 end = t->data[ t->offset + t->strides[ 0 ] ];
+    char* emsg = tensorSlice( ts, ts->size - 1, code[ i ].arg, start, end );
+    if( emsg )
+      return emsg;
+    i += 2;
+    DISPATCH();
+  }
+  HOT( CATI ): {
+    if( ( code[ i ].depth < 2 && ts->size < 2 ) || ts->stack[ ts->size - 2 ]->rank != ts->stack[ ts->size - 1 ]->rank )
+      goto cold;
+    char* emsg = tensorCat( ts, ts->size - 2, ts->size - 1, code[ i ].arg );
+    if( emsg )
+      return emsg;
+    pop( ts );
+    i += 2;
+    DISPATCH();
+  }
+  HOT( RESHAPEI ): {
+    if( !code[ i ].depth && !ts->size )
+      goto cold;
+    const tensor* t = code[ i ].tensor;
+    u32 shape[ 4 ] = { 1, 1, 1, 1 };
+    for( u32 j = 0; j < code[ i ].arg; ++j )
+      shape[ j ] = t->data[ t->offset + t->strides[ 0 ] * j ];
+    char* emsg = tensorReshape( ts, ts->size - 1, code[ i ].arg, shape );
+    if( emsg )
+      return emsg;
+    i += 2;
+    DISPATCH();
+  }
+  }
+}
+#undef HOT
+#undef DISPATCH
+
+// Script slices opened by CALL and not yet closed by RETURN, and how many were
+// already open when the innermost runProgram began. Quit, load, continue and
+// errors can all leave runProgram inside a call, so it closes its own leftovers.
+static u32 traceDepth = 0;
+static u32 traceBase = 0;
+// The step being profiled, if any. Steps that leave runProgram early, by quit,
+// load, continue or an error, are recorded on the way out.
+typedef struct {
+  const step* s;
+  u64 start;
+} stepTiming;
+static void profileTiming( stepTiming* t ){
+  if( !t->s )
+    return;
+  profileStep( t->s->filename, t->s->linenum, t->s->commandnum, t->s->type,
+               SDL_GetPerformanceCounter() - t->start );
+  t->s = NULL;
+}
+static char* runSteps( tensorStack* ts, program** progp, u32 startstep, bool* ret,
+                       stepTiming* timing ){
   program* p = *progp;
   CHECK_GL_ERROR();
   for( u32 i = startstep; i < p->numSteps; ++i ){
+    // The per step instrumentation only lives in the cold path.
+    if( p->code && !profiling && !memProfiling && !tracing ){
+      char* err = runHot( ts, p, &i );
+      if( err )
+        return err;
+      if( i >= p->numSteps )
+        break;
+    }
     // dbg( "Step %u", i );
     step* s = p->steps + i;
+    timing->s = profiling ? s : NULL;
+    timing->start = profiling ? SDL_GetPerformanceCounter() : 0;
+    if( memProfiling )
+      memProfileStep( s->filename, s->linenum, s->commandnum );
     switch( s->type ){
     case IMG: {
       if( !ts->size )
@@ -2120,11 +2768,9 @@ char* runProgram( tensorStack* ts, program** progp, u32 startstep, bool* ret ){
     case WINDOWSIZE: {
       static const u32 wsshape[ 1 ] = { 2 };
       int windowWidth, windowHeight;
-      SDL_GetWindowSize( window, &windowWidth, &windowHeight );
-      f32* data = mem( 2, f32 );
-      data[ 0 ] = windowWidth;
-      data[ 1 ] = windowHeight;
-      push( ts, newTensor( 1, wsshape, data ) );
+      inputWindowSize( &windowWidth, &windowHeight );
+      f32 data[ 2 ] = { windowWidth, windowHeight };
+      push( ts, newSmallTensor( 1, wsshape, data ) );
       break;
     }
     case TEXTINPUT: {
@@ -2155,7 +2801,7 @@ char* runProgram( tensorStack* ts, program** progp, u32 startstep, bool* ret ){
     }
     case GETINPUT: {
       static const u32 wsshape[ 1 ] = { 6 };
-      f32* data = mem( 6, f32 );
+      f32 data[ 6 ];
       data[ 0 ] = dx;dx = 0;
       data[ 1 ] = dy;dy = 0;
       f32 delta = ( mouseWheel - mouseWheelPos ) / 10.0;
@@ -2195,7 +2841,7 @@ char* runProgram( tensorStack* ts, program** progp, u32 startstep, bool* ret ){
 #ifndef __EMSCRIPTEN__
       //SDL_UnlockMutex( data_mutex );
 #endif
-      push( ts, newTensor( 1, wsshape, data ) );
+      push( ts, newSmallTensor( 1, wsshape, data ) );
       break;
     }
     case GAMEPAD: {
@@ -2206,17 +2852,18 @@ char* runProgram( tensorStack* ts, program** progp, u32 startstep, bool* ret ){
       f32* data;
       
       for( u32 i = 0; i < MAX_CONTROLLERS; ++i )
-        if( controllers[ i ] ){
+        if( inputControllerPresent( i ) ){
           ++gpshape[ 0 ];
         }
-      data = mem( gpshape[ 0 ] * 21, f32 );
+      tensor* t = newTransientTensor( 2, gpshape );
+      data = t->data;
       u32 c = 0;
       for( u32 i = 0; i < MAX_CONTROLLERS; ++i )
-        if( controllers[ i ] ){
+        if( inputControllerPresent( i ) ){
           memcpy( data + c++ * 21, &joysticks[ i * 21 ], sizeof( f32 ) * 21 );
         }
 
-      push( ts, newTensor( 2, gpshape, data ) );
+      push( ts, t );
 #ifndef __EMSCRIPTEN__
       //SDL_UnlockMutex( data_mutex );
 #endif
@@ -2295,7 +2942,7 @@ char* runProgram( tensorStack* ts, program** progp, u32 startstep, bool* ret ){
 
       tensorToHostMemory( ts->stack[ ts->size - 1 ] );
       tensor* t = ts->stack[ ts->size - 1 ];
-      f32* ret = mem( 1, f32 );
+      f32 sum = 0.0;
       for( s32 i0 = 0; i0 < t->shape[ 0 ]; ++i0 )
         for( s32 i1 = 0; i1 < t->shape[ 1 ]; ++i1 )
           for( s32 i2 = 0; i2 < t->shape[ 2 ]; ++i2 )
@@ -2303,11 +2950,11 @@ char* runProgram( tensorStack* ts, program** progp, u32 startstep, bool* ret ){
               f32* offset = t->data + t->offset + i0 * t->strides[ 0 ] +
                 i1 * t->strides[ 1 ] + i2 * t->strides[ 2 ] +
                 i3 * t->strides[ 3 ];
-              *ret += *offset;
+              sum += *offset;
             }
 
       pop( ts );
-      push( ts, newTensor( 0, NULL, ret ) );
+      push( ts, newSmallTensor( 0, NULL, &sum ) );
       // dbg( "%s", "add" );
       break;
     }
@@ -2594,6 +3241,7 @@ char* runProgram( tensorStack* ts, program** progp, u32 startstep, bool* ret ){
              "Attempt to call sin without an argument." );
 
       tensorToHostMemory( ts->stack[ ts->size - 1 ] );
+      takeOwnership( ts->stack[ ts->size - 1 ] );
       tensor* t1 = ts->stack[ ts->size - 1 ];
       for( s32 i0 = 0; i0 < t1->shape[ 0 ]; ++i0 )
         for( s32 i1 = 0; i1 < t1->shape[ 1 ]; ++i1 )
@@ -2614,6 +3262,7 @@ char* runProgram( tensorStack* ts, program** progp, u32 startstep, bool* ret ){
              "Attempt to call cos without an argument." );
 
       tensorToHostMemory( ts->stack[ ts->size - 1 ] );
+      takeOwnership( ts->stack[ ts->size - 1 ] );
       tensor* t1 = ts->stack[ ts->size - 1 ];
       for( s32 i0 = 0; i0 < t1->shape[ 0 ]; ++i0 )
         for( s32 i1 = 0; i1 < t1->shape[ 1 ]; ++i1 )
@@ -2634,6 +3283,7 @@ char* runProgram( tensorStack* ts, program** progp, u32 startstep, bool* ret ){
              "Attempt to call floor without an argument." );
 
       tensorToHostMemory( ts->stack[ ts->size - 1 ] );
+      takeOwnership( ts->stack[ ts->size - 1 ] );
       tensor* t1 = ts->stack[ ts->size - 1 ];
       for( s32 i0 = 0; i0 < t1->shape[ 0 ]; ++i0 )
         for( s32 i1 = 0; i1 < t1->shape[ 1 ]; ++i1 )
@@ -2654,6 +3304,7 @@ char* runProgram( tensorStack* ts, program** progp, u32 startstep, bool* ret ){
              "Attempt to call ceil without an argument." );
 
       tensorToHostMemory( ts->stack[ ts->size - 1 ] );
+      takeOwnership( ts->stack[ ts->size - 1 ] );
       tensor* t1 = ts->stack[ ts->size - 1 ];
       for( s32 i0 = 0; i0 < t1->shape[ 0 ]; ++i0 )
         for( s32 i1 = 0; i1 < t1->shape[ 1 ]; ++i1 )
@@ -2674,6 +3325,7 @@ char* runProgram( tensorStack* ts, program** progp, u32 startstep, bool* ret ){
              "Attempt to call log without an argument." );
 
       tensorToHostMemory( ts->stack[ ts->size - 1 ] );
+      takeOwnership( ts->stack[ ts->size - 1 ] );
       tensor* t1 = ts->stack[ ts->size - 1 ];
       for( s32 i0 = 0; i0 < t1->shape[ 0 ]; ++i0 )
         for( s32 i1 = 0; i1 < t1->shape[ 1 ]; ++i1 )
@@ -2712,10 +3364,9 @@ char* runProgram( tensorStack* ts, program** progp, u32 startstep, bool* ret ){
             }
       
       pop( ts );
-      f32* nt = mem( 2, f32 );
-      nt[ 0 ] = min; nt[ 1 ] = max;
+      f32 nt[ 2 ] = { min, max };
       u32 ntshape[ 1 ] = { 2 };
-      push( ts, newTensor( 1, ntshape, nt ) );
+      push( ts, newSmallTensor( 1, ntshape, nt ) );
       // dbg( "%s", "minmax" );
 
       break;
@@ -2757,6 +3408,33 @@ char* runProgram( tensorStack* ts, program** progp, u32 startstep, bool* ret ){
       textBufferPos = 0;
       break;
     }
+    case PROFILE:{
+      if( !ts->size )
+        err( "%s:%u command %u: %s", s->filename, s->linenum, s->commandnum, "Attempt to profile with no parameter on the stack." );
+      if( ts->stack[ ts->size - 1 ]->rank )
+        err( "%s:%u command %u: %s", s->filename, s->linenum, s->commandnum, "Attempt to profile with a nonscalar parameter." );
+
+      tensorToHostMemory( ts->stack[ ts->size - 1 ] );
+      u32 count = *( ts->stack[ ts->size - 1 ]->data +
+                     ts->stack[ ts->size - 1 ]->offset );
+      pop( ts );
+      if( !profiling )
+        profileStart();
+      else if( count )
+        profileReport( count );
+      else
+        profileReset();
+      break;
+    }
+    case GLSTATS:{
+      const u32 shape[] = { GLSTATS_COUNT };
+      const u64* last = (const u64*)&glStatsLast;
+      f32* counts = mem( GLSTATS_COUNT, f32 );
+      for( u32 i = 0; i < GLSTATS_COUNT; ++i )
+        counts[ i ] = last[ i ];
+      push( ts, newTensor( 1, shape, counts ) );
+      break;
+    }
     case FULLSCREEN:{
       fullscreen = !fullscreen;
       break;
@@ -2807,15 +3485,29 @@ char* runProgram( tensorStack* ts, program** progp, u32 startstep, bool* ret ){
       }
       p->returns[ p->numReturns++ ] = i;
       i = s->branch - 1;
+      if( tracing ){
+        traceBegin( "script", "%s:%u", p->steps[ s->branch ].filename, p->steps[ s->branch ].linenum );
+        ++traceDepth;
+      }
       // dbg( "%s", "call" );
       break;
     case RETURN:
       if( !p->numReturns )
         err( "%s:%u command %u: %s", s->filename, s->linenum, s->commandnum, "Attempt to return with an empty return stack." );
       i = p->returns[ --p->numReturns ];
+      if( traceDepth > traceBase ){
+        traceEnd();
+        --traceDepth;
+      }
       // dbg( "%s", "return" );
       break;
     case COMPUTE:{
+      // Built the first time it runs.
+      if( p->computes[ s->compute ]->build ){
+        char* emsg = finishCompute( p, p->computes[ s->compute ] );
+        if( emsg )
+          return emsg;
+      }
       if( ts->size < 2 )
         err( "%s:%u command %u: %s", s->filename, s->linenum, s->commandnum,
              "Attempt to run a compute statement without both a shape parameter and a vertex count on "
@@ -2852,7 +3544,10 @@ char* runProgram( tensorStack* ts, program** progp, u32 startstep, bool* ret ){
       pop( ts );
       
       tensor** rets;
+      u64 computeStart = tracing ? traceNow() : 0;
       char* emsg = newTensorsInitialized( p, ts, rank, shape, p->computes[ s->compute ], vertCount, &rets );
+      if( tracing )
+        traceComplete( "gpu", computeStart, "compute %s:%u", s->filename, s->linenum );
       if( emsg )
         return emsg;
       if( rets ){
@@ -2946,12 +3641,11 @@ char* runProgram( tensorStack* ts, program** progp, u32 startstep, bool* ret ){
       if( t->rank != 1 || t->shape[ 0 ] != 2 )
         err( "%s:%u command %u: %s", s->filename, s->linenum, s->commandnum,
              "Expected a rank 1 length 2 vector for atan." );
-      f32* ret = mem( 1, f32 );
       f32 x = t->data[ t->offset + t->strides[ 0 ] * 0 ];
       f32 y = t->data[ t->offset + t->strides[ 0 ] * 1 ];
       pop( ts );
-      *ret = atan2f( y, x );
-      push( ts, newTensor( 0, NULL, ret ) );
+      f32 ret = atan2f( y, x );
+      push( ts, newSmallTensor( 0, NULL, &ret ) );
       break;
     }
     case PROJ: {
@@ -3030,12 +3724,12 @@ char* runProgram( tensorStack* ts, program** progp, u32 startstep, bool* ret ){
         err( "%s:%u command %u: %s", s->filename, s->linenum, s->commandnum,
              "Attempt to get the shape of a tensor with nothing on the stack." );
       tensor* cur = ts->stack[ ts->size - 1 ];
-      f32* newData = mem( cur->rank, f32 );
+      f32 newData[ 4 ];
       for( u32 i = 0; i < cur->rank; ++i )
         newData[ i ] = cur->shape[ i ];
       u32 newShape[ 1 ] = { cur->rank };
       pop( ts );
-      push( ts, newTensor( 1, newShape, newData ) );
+      push( ts, newSmallTensor( 1, newShape, newData ) );
       // dbg( "%s %u", "shape", axis );
       break;
     }
@@ -3051,32 +3745,31 @@ char* runProgram( tensorStack* ts, program** progp, u32 startstep, bool* ret ){
       for( u32 i = 0; i < top->shape[ 0 ]; ++i )
         sumsquares += top->data[ top->offset + top->strides[ 0 ] * i ] *
           top->data[ top->offset + top->strides[ 0 ] * i ];
-      f32* newData = mem( 1, f32 );
-      *newData = sqrtf( sumsquares );
+      f32 length = sqrtf( sumsquares );
       pop( ts );
-      push( ts, newTensor( 0, NULL, newData ) );
-      // dbg( "%s %f", "length", *newData );
+      push( ts, newSmallTensor( 0, NULL, &length ) );
+      // dbg( "%s %f", "length", length );
       break;
     }
     case TIMEDELTA: {
-      f32* time = mem( 1, f32 );
-      *time = timeDelta;
-      push( ts, newTensor( 0, NULL, time ) );
+      f32 time = timeDelta;
+      push( ts, newSmallTensor( 0, NULL, &time ) );
       // dbg( "%s", "timeDelta" );
       break;
     }
     case TIME: {
       const u32 shape[] = { 2 };
-      f32* time = mem( 2, f32 );
+      f32 time[ 2 ];
       time[ 0 ] = floorf( runTime / 3600  );
       time[ 1 ] = runTime - ( (f64)( time[ 0 ] ) * 3600.0 );
-      push( ts, newTensor( 1, shape, time ) );
+      push( ts, newSmallTensor( 1, shape, time ) );
       // dbg( "%s", "timeDelta" );
       break;
     }
     case LOAD: {
       if( p->numFilenames >= NUM_FILENAMES )
         err( "%s", "Filename count exceeded, too many files opened in one session." );
+      u64 loadStart = tracing ? traceNow() : 0;
       if( !s->progName ){
         if( !ts->size )
           err( "%s:%u command %u: %s", s->filename, s->linenum, s->commandnum,
@@ -3086,19 +3779,30 @@ char* runProgram( tensorStack* ts, program** progp, u32 startstep, bool* ret ){
           err( "%s:%u command %u: %s", s->filename, s->linenum, s->commandnum,
                "Attempt to load a string filename with a nonvector." );
         char* fn = tensorToString( ts->stack[ ts->size - 1 ] );
-        p->filenames[ p->numFilenames++ ] = fn;
         char* err = newProgramFromFile( fn, &p );
-        if( err )
+        if( err ){
+          unmem( fn );
           return err;
+        }
+        // The loaded program's steps point at its name, so it owns it.
+        p->filenames[ p->numFilenames++ ] = fn;
       }else{
         u32 len = strlen( s->progName );
         char* nn = mem( len + 2, char );
-        p->filenames[ p->numFilenames++ ] = nn;
         strncpy( nn, s->progName, len + 2 );
         char* err = newProgramFromFile( nn, &p );
-        if( err )
+        if( err ){
+          unmem( nn );
           return err;
+        }
+        p->filenames[ p->numFilenames++ ] = nn;
       }
+      if( tracing )
+        traceComplete( "script", loadStart, "load %s:%u", s->filename, s->linenum );
+      profileTiming( timing );
+      // The step's filename goes with the program.
+      if( memProfiling )
+        memProfileStep( NULL, 0, 0 );
       deleteProgram( *progp );
       *progp = p;
       while( ts->size )
@@ -3162,24 +3866,27 @@ char* runProgram( tensorStack* ts, program** progp, u32 startstep, bool* ret ){
       codeToRun = tensorToString( cur );
         
       pop( ts );
+      // The eval may add variables, moving the uniform block out from under
+      // any views of it.
+      for( u32 i = 0; i < ts->size; ++i )
+        keepTensor( ts->stack[ i ] );
 
       u32 start = 0;
       program* tempProg;
-      char* err = copyProgramWithEval( p, codeToRun, &start, &tempProg );
+      u64 evalStart = tracing ? traceNow() : 0;
+      char* err = newProgramWithEval( p, codeToRun, &start, &tempProg );
+      if( tracing )
+        traceComplete( "script", evalStart, "eval compile %s:%u", s->filename, s->linenum );
       if( err ){
         print( "%s\n", err );
         unmem( err );
         unmem( codeToRun );
       } else{
-        copyProgramState( p, tempProg, false );
         bool iret = true;
         char* err = runProgram( ts, &tempProg, start, &iret );
-        if( !err ){
-          copyProgramState( tempProg, p, true );
-          
-          for( u32 i = 0; i < ts->size; ++i )
-            takeOwnership( ts->stack[ i ] );
-        } else{
+        if( memProfiling )
+          memProfileStep( s->filename, s->linenum, s->commandnum );
+        if( err ){
           print( "%s\n", err );
           unmem( err );
         }
@@ -3249,18 +3956,14 @@ char* runProgram( tensorStack* ts, program** progp, u32 startstep, bool* ret ){
         if( emsg ){
           return emsg;
         }
-        f32* ndata = mem( 1, f32 );
-        *ndata = progress;
-        push( ts, newTensor( 0, NULL, ndata ) );
+        push( ts, newSmallTensor( 0, NULL, &progress ) );
       } else{ 
         char* emsg = unkettle( ts, NULL, &progress );
         if( emsg ){
           progress = 3.0;
           return emsg;
         }
-        f32* ndata = mem( 1, f32 );
-        *ndata = progress;
-        push( ts, newTensor( 0, NULL, ndata ) );
+        push( ts, newSmallTensor( 0, NULL, &progress ) );
         if( progress == 0.0 )
           progress = 3.0;
       }
@@ -3308,15 +4011,7 @@ char* runProgram( tensorStack* ts, program** progp, u32 startstep, bool* ret ){
       pop( ts );
       if( bury >= ts->size )
         err( "%s:%u command %u: %s", s->filename, s->linenum, s->commandnum, "Attempt to bury past the end of the stack." );
-      tensor* tb = ts->stack[ ts->size - 1 ];
-      for( u32 i = ts->size - 1; i > ( ts->size - 1 ) - bury; --i ){
-        if( !tb->ownsData && ts->stack[ i - 1 ]->ownsData &&
-            tb->gpu == ts->stack[ i - 1 ]->gpu &&
-            ( tb->data == ts->stack[ i - 1 ]->data || tb->tex.texture == ts->stack[ i - 1 ]->tex.texture ) )
-          takeOwnership( tb );
-        ts->stack[ i ] = ts->stack[ i - 1 ];
-      }
-      ts->stack[ ( ts->size - 1 ) - bury ] = tb;
+      buryTensor( ts, bury );
       break;
     }
     case RAISE: {
@@ -3331,15 +4026,7 @@ char* runProgram( tensorStack* ts, program** progp, u32 startstep, bool* ret ){
       pop( ts );
       if( raise >= ts->size )
         err( "%s:%u command %u: %s", s->filename, s->linenum, s->commandnum, "Attempt to raise past the end of the stack." );
-      tensor* tr = ts->stack[ ( ts->size - 1 ) - raise ];
-      for( u32 i = ( ts->size - 1 ) - raise; i < ts->size - 1; ++i ){
-        if( tr->ownsData && !ts->stack[ i + 1 ]->ownsData &&
-            tr->gpu == ts->stack[ i + 1 ]->gpu &&
-            ( tr->data == ts->stack[ i + 1 ]->data || tr->tex.texture == ts->stack[ i + 1 ]->tex.texture ) )
-          takeOwnership( ts->stack[ i + 1 ] );
-        ts->stack[ i ] = ts->stack[ i + 1 ];
-      }
-      ts->stack[ ts->size - 1 ] = tr;
+      raiseTensor( ts, raise );
       break;
     }
     case BACKFACE: {
@@ -3455,9 +4142,8 @@ char* runProgram( tensorStack* ts, program** progp, u32 startstep, bool* ret ){
       break;
     }
     case TOP: {
-      f32* ssize = mem( 1, f32 );
-      *ssize = ts->size;
-      push( ts, newTensor( 0, NULL, ssize ) );
+      f32 ssize = ts->size;
+      push( ts, newSmallTensor( 0, NULL, &ssize ) );
       // dbg( "%s %u %u", "size", axis1, axis2 );
       break;
     }
@@ -3466,13 +4152,13 @@ char* runProgram( tensorStack* ts, program** progp, u32 startstep, bool* ret ){
       break;
     }
     case KEYS: {
-      f32* data = mem( SDL_NUM_SCANCODES, f32 );
       //mainPoll();
       const u8* ks = keys;
       u32 size = SDL_NUM_SCANCODES;
+      tensor* t = newTransientTensor( 1, &size );
       for( u32 i = 0; i < SDL_NUM_SCANCODES; ++i )
-        data[ i ] = ks[ i ];
-      push( ts, newTensor( 1, &size, data ) );
+        t->data[ i ] = ks[ i ];
+      push( ts, t );
       break;
     }
     case SET:
@@ -3486,7 +4172,7 @@ char* runProgram( tensorStack* ts, program** progp, u32 startstep, bool* ret ){
           deleteTensor( p->bigvarts[ s->var.index ] );
         p->bigvarts[ s->var.index ] = ts->stack[ ts->size - 1 ];
         ts->stack[ --ts->size ] = NULL;
-        takeOwnership( p->bigvarts[ s->var.index ] );
+        keepTensor( p->bigvarts[ s->var.index ] );
 
       }else{
         if( ( s->var.size <= 4 && ts->stack[ ts->size - 1 ]->rank != 1 ) ||
@@ -3514,6 +4200,9 @@ char* runProgram( tensorStack* ts, program** progp, u32 startstep, bool* ret ){
                    ts->stack[ ts->size - 1 ]->strides[ 0 ] * i +
                    ts->stack[ ts->size - 1 ]->strides[ 1 ] * j );
         for( u32 i = 0; i < p->numComputes; ++i ){
+          // One not yet built loads every variable once it is.
+          if( p->computes[ i ]->build )
+            continue;
           glUseProgram( p->computes[ i ]->program );
           switch( p->varSizes[ s->var.index ] ){
           case 1:
@@ -3552,52 +4241,19 @@ char* runProgram( tensorStack* ts, program** progp, u32 startstep, bool* ret ){
       }
       break;
     case GET: {
-      if( !s->var.size ){
-        tensor* t = copyTensor( p->bigvarts[ s->var.index ] );
-        takeOwnership( t );
-        push( ts, t );
-      }else{
-        static const u32 shape1[ 4 ] = { 1 };
-        static const u32 shape2[ 4 ] = { 2 };
-        static const u32 shape3[ 4 ] = { 3 };
-        static const u32 shape4[ 4 ] = { 4 };
-        static const u32 shape16[ 2 ] = { 4, 4 };
-        const u32* shape;
-        u32 rank = 1;
-        switch( p->varSizes[ s->var.index ] ){
-        case 1:
-          shape = shape1;
-          break;
-        case 2:
-          shape = shape2;
-          break;
-        case 3:
-          shape = shape3;
-          break;
-        case 4:
-          shape = shape4;
-          break;
-        case 16:
-          shape = shape16;
-          rank = 2;
-          break;
-        default:
-          err( "%s %u.",
-               "Logic error in atlas! Bad p->varSizes[ s->var.index ]",
-               p->varSizes[ s->var.index ] );
-        }
-        tensor* t =
-          newTensor( rank, shape, p->varBlock + p->varOffsets[ s->var.index ] );
-        t->ownsData = false;  // Ensure the tensor does not own the data
-        push( ts, t );
-      }
+      tensor* t = getVariable( p, s->var.index, s->var.size );
+      if( !t )
+        err( "%s %u.",
+             "Logic error in atlas! Bad p->varSizes[ s->var.index ]",
+             p->varSizes[ s->var.index ] );
+      push( ts, t );
       // dbg( "%s", "get" );
       break;
     }
     case MOVE: {
       if( !s->var.size ){
-        f32* nt = mem( 1, f32 );
-        tensor* t = newTensor( 0, NULL, nt );
+        f32 zero = 0.0;
+        tensor* t = newSmallTensor( 0, NULL, &zero );
         push( ts, p->bigvarts[ s->var.index ] );
         p->bigvarts[ s->var.index ] = t;
       }else{
@@ -3642,7 +4298,7 @@ char* runProgram( tensorStack* ts, program** progp, u32 startstep, bool* ret ){
       glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
   
       // Delete GPU resources now - driver keeps them alive until PBO copy completes
-      if( t->ownsData ){
+      if( releaseData( t ) ){
         if( t->tex.texture ) glDeleteTextures( 1, &t->tex.texture );
         if( t->tex.framebuffer ) glDeleteFramebuffers( 1, &t->tex.framebuffer );
         if( t->tex.depthbuffer ) glDeleteRenderbuffers( 1, &t->tex.depthbuffer );
@@ -3710,6 +4366,19 @@ char* runProgram( tensorStack* ts, program** progp, u32 startstep, bool* ret ){
     default:
       err( "%s", "Logic error in Atlas!" );
     }
+    profileTiming( timing );
   }
   *ret = true; return NULL;
 }
+// A pointer pointer because program might change during e.g. a load.
+char* runProgram( tensorStack* ts, program** progp, u32 startstep, bool* ret ){
+  u32 base = traceBase;
+  traceBase = traceDepth;
+  stepTiming timing = { 0 };
+  char* err = runSteps( ts, progp, startstep, ret, &timing );
+  profileTiming( &timing );
+  for( ; traceDepth > traceBase; --traceDepth )
+    traceEnd();
+  traceBase = base;
+  return err;
+}
@@ -10,7 +10,8 @@
 #include "trie.h"
 
 
-// To add a command: add it in runProgram in program.c, here, and in the addStep parser in program.c.
+// To add a command: add it in runProgram in program.c, here, in stepTypeNames and in the addStep parser in program.c,
+// or in commandNames there if it is a bare keyword.
 // Also add it to the documentation, docs/index.html.
 typedef struct{
   enum{
@@ -97,7 +98,10 @@ typedef struct{
     WORKSPACE, // documented
     TRANSFERSTART, // documented
     TRANSFEREND, // documented
-    IMG // documented
+    IMG, // documented
+    PROFILE, // documented
+    GLSTATS, // documented
+    STEPTYPECOUNT // Not a command, the number of step types.
   } type;
   union{
     tensor* tensor;
@@ -125,6 +129,7 @@ typedef struct{
       };
       u32 index;
       u32 size;
+      bool wasGet; // A get moveVariables made a move.
     } var;
     u32 compute;
     struct{
@@ -140,13 +145,49 @@ typedef struct{
   u32 commandnum;
 } step;
 
-#define NUM_FILENAMES 65536
+// The hot instruction stream finalize lowers the steps into: just an opcode and
+// its resolved operands, so the dispatch loop walks a dense array. The steps
+// stay alongside as the cold table of source locations and large payloads,
+// indexed the same way.
 typedef struct{
-  char* mainFilename;
+  u16 op; // A step type or one of the superinstructions below.
+  u8 size; // The variable size for GET, SET and MOVE.
+  u8 depth; // The least the stack can hold here, capped at 255.
+  u32 arg; // The branch target, variable or compute index, or an immediate.
+  tensor* tensor; // The literal for TENSOR.
+} instruction;
+
+// Superinstructions fuse a common pair of steps into the first one's slot. The
+// second keeps its own instruction, so a branch landing on it still runs it.
+enum{
+  TENSORSET = STEPTYPECOUNT, // A literal set straight into a tensor variable.
+  GETIF, // A tensor variable tested by if without copying it.
+  GETIFN, // The same for ifn.
+  JUMP, // A literal condition that always branches.
+  SKIP, // A literal condition that never branches.
+  // A literal operand folded into the command after it, held in arg, or read
+  // in place from the literal for slice and reshape.
+  DUPI,
+  RAISEI,
+  BURYI,
+  REPEATI,
+  SLICEI,
+  CATI,
+  RESHAPEI,
+  INSTRUCTIONCOUNT
+};
+
+#define NUM_FILENAMES 65536
+typedef struct program{
+  // The program an eval overlay extends, or NULL. An overlay starts with a copy
+  // of its steps and computes and shares its variables, so only what the eval
+  // adds is its own.
+  struct program* parent;
   compute** computes;
   u32 numComputes;
   u32 computeStackSize;
   step* steps;
+  instruction* code; // numSteps + 1 long, built by finalize.
   trieNode* labels;
   u32 numSteps;
   u32 stepStackSize;
@@ -167,9 +208,13 @@ typedef struct{
   u32 numFilenames;
 } program;
 
+// Names of the step types, indexed by step.type.
+extern const char* stepTypeNames[ STEPTYPECOUNT ];
+
 char* newProgramFromFile( const char* filename, program** ret );
+// Makes an overlay of p running eval from startStep. p must outlive it.
 // mutates but does not deallocate the string eval.
-char* copyProgramWithEval( program* p, const char* eval, u32* startStep, program** ret );
+char* newProgramWithEval( program* p, char* eval, u32* startStep, program** ret );
 // Return false to exit program.
 char* runProgram( tensorStack* ts, program** progp, u32 startstep, bool* ret );
 void deleteProgram( program* p );
@@ -0,0 +1,138 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright © 2025 Jon DuBois. Written with the assistance of GPT-4 et al.   //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Atlas.h"
+
+bool recording = false;
+bool replaying = false;
+
+#define REPLAY_MAGIC "ATLASINP"
+#define REPLAY_VERSION 1
+
+// One frame of input. Written as is, so recordings are only portable between
+// builds with the same layout, which the header checks.
+typedef struct{
+  f64 timeDelta;
+  f64 runTime;
+  f32 dx, dy, posx, posy;
+  f32 mouseWheel;
+  f32 pinchZoom;
+  u32 buttons;
+  s32 width, height;
+  u32 controllers; // Bit i is set if controllers[ i ] is connected.
+  f32 joysticks[ MAX_CONTROLLERS * 21 ];
+  u8 keys[ SDL_NUM_SCANCODES ];
+  u8 doubleClicks[ 3 ];
+  u8 touchClicks[ 3 ];
+  u32 textLength; // Followed by this many bytes of textInputBuffer.
+} inputRecord;
+
+static FILE* inputFile = NULL;
+static inputRecord current;
+
+static void openInput( const char* filename, const char* mode ){
+  inputFile = fopen( filename, mode );
+  if( !inputFile )
+    error( "Failed to open input recording %s.", filename );
+}
+
+void recordStart( const char* filename ){
+  openInput( filename, "wb" );
+  u32 header[ 2 ] = { REPLAY_VERSION, sizeof( inputRecord ) };
+  fwrite( REPLAY_MAGIC, 1, 8, inputFile );
+  fwrite( header, sizeof( u32 ), 2, inputFile );
+  recording = true;
+}
+
+void replayStart( const char* filename ){
+  openInput( filename, "rb" );
+  char magic[ 8 ];
+  u32 header[ 2 ];
+  if( fread( magic, 1, 8, inputFile ) != 8 || memcmp( magic, REPLAY_MAGIC, 8 ) ||
+      fread( header, sizeof( u32 ), 2, inputFile ) != 2 )
+    error( "%s is not an input recording.", filename );
+  if( header[ 0 ] != REPLAY_VERSION || header[ 1 ] != sizeof( inputRecord ) )
+    error( "The input recording %s was made by an incompatible build.", filename );
+  replaying = true;
+}
+
+static void recordFrame( void ){
+  current.timeDelta = timeDelta;
+  current.runTime = runTime;
+  current.dx = dx;
+  current.dy = dy;
+  current.posx = posx;
+  current.posy = posy;
+  current.mouseWheel = mouseWheel;
+  current.pinchZoom = pinchZoom;
+  current.buttons = buttons;
+  SDL_GetWindowSize( window, &current.width, &current.height );
+  current.controllers = 0;
+  for( u32 i = 0; i < MAX_CONTROLLERS; ++i )
+    if( controllers[ i ] )
+      current.controllers |= 1u << i;
+  memcpy( current.joysticks, joysticks, sizeof( current.joysticks ) );
+  memcpy( current.keys, keys, sizeof( current.keys ) );
+  for( u32 i = 0; i < 3; ++i ){
+    current.doubleClicks[ i ] = doubleClicks[ i ];
+    current.touchClicks[ i ] = touchClicks[ i ];
+  }
+  current.textLength = strnlen( textInputBuffer, TEXTINPUTBUFFERSIZE - 1 );
+  fwrite( &current, sizeof( inputRecord ), 1, inputFile );
+  fwrite( textInputBuffer, 1, current.textLength, inputFile );
+}
+
+static bool replayFrame( void ){
+  if( fread( &current, sizeof( inputRecord ), 1, inputFile ) != 1 ||
+      current.textLength >= TEXTINPUTBUFFERSIZE ||
+      fread( textInputBuffer, 1, current.textLength, inputFile ) != current.textLength )
+    return false;
+  textInputBuffer[ current.textLength ] = '\0';
+  textInputBufferPos = current.textLength;
+  timeDelta = current.timeDelta;
+  runTime = current.runTime;
+  dx = current.dx;
+  dy = current.dy;
+  posx = current.posx;
+  posy = current.posy;
+  mouseWheel = current.mouseWheel;
+  pinchZoom = current.pinchZoom;
+  buttons = current.buttons;
+  memcpy( joysticks, current.joysticks, sizeof( current.joysticks ) );
+  memcpy( keys, current.keys, sizeof( current.keys ) );
+  for( u32 i = 0; i < 3; ++i ){
+    doubleClicks[ i ] = current.doubleClicks[ i ];
+    touchClicks[ i ] = current.touchClicks[ i ];
+  }
+  return true;
+}
+
+bool inputFrame( void ){
+  if( recording )
+    recordFrame();
+  else if( replaying )
+    return replayFrame();
+  return true;
+}
+
+void inputFinish( void ){
+  if( inputFile )
+    fclose( inputFile );
+  inputFile = NULL;
+  recording = replaying = false;
+}
+
+void inputWindowSize( int* width, int* height ){
+  if( replaying ){
+    *width = current.width;
+    *height = current.height;
+  } else
+    SDL_GetWindowSize( window, width, height );
+}
+
+bool inputControllerPresent( u32 index ){
+  if( replaying )
+    return current.controllers & ( 1u << index );
+  return controllers[ index ];
+}
@@ -0,0 +1,27 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright © 2025 Jon DuBois. Written with the assistance of GPT-4 et al.   //
+////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef REPLAY_H_INCLUDED
+#define REPLAY_H_INCLUDED
+
+// Input record and replay. With --record FILE the input state each frame
+// starts with is written to FILE, and with --replay FILE it is read back in
+// place of live input, along with the recorded timeDelta and runTime, so runs
+// of interactive scripts can be compared.
+extern bool recording;
+extern bool replaying;
+
+void recordStart( const char* filename );
+void replayStart( const char* filename );
+// Called by the render thread at the start of each frame, before runProgram.
+// Returns false once a replay has run out of frames.
+bool inputFrame( void );
+void inputFinish( void );
+// The window size, as recorded while replaying.
+void inputWindowSize( int* width, int* height );
+// Whether gamepad index is connected, as recorded while replaying.
+bool inputControllerPresent( u32 index );
+
+#endif //REPLAY_H_INCLUDED
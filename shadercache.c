@@ -0,0 +1,290 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright © 2025 Jon DuBois. Written with the assistance of GPT-4 et al.   //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Atlas.h"
+
+#ifndef __EMSCRIPTEN__
+#ifdef _WIN32
+#include <direct.h>
+#define makeDirectory( d ) _mkdir( d )
+#else
+#include <sys/stat.h>
+#define makeDirectory( d ) mkdir( d, 0755 )
+#endif
+#endif
+
+typedef struct{
+  u64 hash;
+  char* vertex;
+  char* fragment;
+  // The GL program and its locations. uniformLocs holds numVars of them.
+  compute linked;
+  u32 numVars;
+  const void* owner;
+  u32 refs;
+  u64 lastUse;
+} shaderEntry;
+
+static shaderEntry* entries = NULL;
+static u32 numEntries = 0;
+static u32 entriesSize = 0;
+static u32 numIdle = 0;
+static u64 useClock = 0;
+
+// FNV-1a over both sources and the argument count, which sets the locations
+// looked up.
+static u64 shaderHash( const char* vertex, const char* fragment, u32 argCount ){
+  u64 h = 14695981039346656037ull;
+  for( const char* s = vertex; *s; ++s )
+    h = ( h ^ (u8)*s ) * 1099511628211ull;
+  h = ( h ^ 0xFF ) * 1099511628211ull;
+  for( const char* s = fragment; *s; ++s )
+    h = ( h ^ (u8)*s ) * 1099511628211ull;
+  return ( h ^ argCount ) * 1099511628211ull;
+}
+static char* copyString( const char* s ){
+  u32 len = strlen( s );
+  char* ret = mem( len + 1, char );
+  memcpy( ret, s, len + 1 );
+  return ret;
+}
+static void deleteEntry( u32 i ){
+  glDeleteProgram( entries[ i ].linked.program );
+  unmem( entries[ i ].vertex );
+  unmem( entries[ i ].fragment );
+  unmem( entries[ i ].linked.uniformLocs );
+  entries[ i ] = entries[ --numEntries ];
+}
+// Deletes the least recently used idle entries while there are too many.
+static void trimIdle( void ){
+  while( numIdle > SHADER_CACHE_IDLE ){
+    u32 oldest = numEntries;
+    for( u32 i = 0; i < numEntries; ++i )
+      if( !entries[ i ].refs &&
+          ( oldest == numEntries || entries[ i ].lastUse < entries[ oldest ].lastUse ) )
+        oldest = i;
+    deleteEntry( oldest );
+    --numIdle;
+  }
+}
+bool shaderCacheFind( const char* vertex, const char* fragment, const void* owner,
+                      u32 numVars, compute* c ){
+  u64 hash = shaderHash( vertex, fragment, c->argCount );
+  for( u32 i = 0; i < numEntries; ++i ){
+    shaderEntry* e = entries + i;
+    if( e->hash != hash || e->linked.argCount != c->argCount || ( e->refs && e->owner != owner ) ||
+        strcmp( e->vertex, vertex ) || strcmp( e->fragment, fragment ) )
+      continue;
+    if( !e->refs )
+      --numIdle;
+    ++e->refs;
+    e->owner = owner;
+    e->lastUse = ++useClock;
+    c->program = e->linked.program;
+    c->dimsLocation = e->linked.dimsLocation;
+    c->stridesLocation = e->linked.stridesLocation;
+    memcpy( c->argDimsLocation, e->linked.argDimsLocation, sizeof( c->argDimsLocation ) );
+    memcpy( c->argStridesLocation, e->linked.argStridesLocation, sizeof( c->argStridesLocation ) );
+    memcpy( c->argToffsetLocation, e->linked.argToffsetLocation, sizeof( c->argToffsetLocation ) );
+    memcpy( c->argTexLocation, e->linked.argTexLocation, sizeof( c->argTexLocation ) );
+    // The same source declares the same variables.
+    c->uniformLocs = mem( numVars, GLuint );
+    for( u32 j = 0; j < numVars; ++j )
+      c->uniformLocs[ j ] = j < e->numVars ? e->linked.uniformLocs[ j ] : (GLuint)-1;
+    return true;
+  }
+  return false;
+}
+void shaderCacheAdd( const char* vertex, const char* fragment, const void* owner,
+                     u32 numVars, const compute* c ){
+  if( numEntries >= entriesSize ){
+    entriesSize = entriesSize ? entriesSize * 2 : 64;
+    shaderEntry* t = mem( entriesSize, shaderEntry );
+    if( entries ){
+      memcpy( t, entries, sizeof( shaderEntry ) * numEntries );
+      unmem( entries );
+    }
+    entries = t;
+  }
+  shaderEntry* e = entries + numEntries++;
+  e->hash = shaderHash( vertex, fragment, c->argCount );
+  e->vertex = copyString( vertex );
+  e->fragment = copyString( fragment );
+  e->linked = *c;
+  e->linked.uniformLocs = mem( numVars, GLuint );
+  memcpy( e->linked.uniformLocs, c->uniformLocs, sizeof( GLuint ) * numVars );
+  e->numVars = numVars;
+  e->owner = owner;
+  e->refs = 1;
+  e->lastUse = ++useClock;
+}
+void shaderCacheRelease( GLuint program ){
+  for( u32 i = 0; i < numEntries; ++i )
+    if( entries[ i ].linked.program == program ){
+      if( !--entries[ i ].refs ){
+        ++numIdle;
+        trimIdle();
+      }
+      return;
+    }
+  glDeleteProgram( program );
+}
+static void diskClear( void );
+void shaderCacheClear( void ){
+  diskClear();
+  for( u32 i = 0; i < numEntries; )
+    if( entries[ i ].refs )
+      ++i;
+    else
+      deleteEntry( i );
+  numIdle = 0;
+  if( !numEntries && entries ){
+    unmem( entries );
+    entries = NULL;
+    entriesSize = 0;
+  }
+}
+
+#ifndef __EMSCRIPTEN__
+static const char* diskDirectory = NULL;
+// The vendor, renderer and version strings binaries are only valid for.
+static char* diskIdentity = NULL;
+// 0 until checked, then 1 if program binaries can be saved, -1 if not.
+static s32 diskState = 0;
+
+typedef struct{
+  char magic[ 8 ];
+  u32 format;
+  u32 identityLen;
+  u32 vertexLen;
+  u32 fragmentLen;
+  u32 binaryLen;
+} shaderFileHeader;
+static const char shaderFileMagic[ 8 ] = "ATLSPRG1";
+
+void shaderCacheDirectory( const char* dir ){
+  diskDirectory = dir;
+}
+// Checked on first use, as it needs the GL context.
+static bool diskReady( void ){
+  if( !diskDirectory )
+    return false;
+  if( !diskState ){
+    GLint formats = 0;
+    glGetIntegerv( GL_NUM_PROGRAM_BINARY_FORMATS, &formats );
+    const char* vendor = (const char*)glGetString( GL_VENDOR );
+    const char* renderer = (const char*)glGetString( GL_RENDERER );
+    const char* version = (const char*)glGetString( GL_VERSION );
+    if( formats <= 0 || !vendor || !renderer || !version ){
+      diskState = -1;
+      return false;
+    }
+    diskIdentity = printToString( "%s\n%s\n%s", vendor, renderer, version );
+    makeDirectory( diskDirectory );
+    diskState = 1;
+  }
+  return diskState > 0;
+}
+static char* diskPath( const char* vertex, const char* fragment ){
+  u64 h = shaderHash( vertex, fragment, 0 );
+  for( const char* s = diskIdentity; *s; ++s )
+    h = ( h ^ (u8)*s ) * 1099511628211ull;
+  return printToString( "%s/%016llx.bin", diskDirectory, (unsigned long long)h );
+}
+GLuint shaderCacheLoad( const char* vertex, const char* fragment ){
+  if( !diskReady() )
+    return 0;
+  char* path = diskPath( vertex, fragment );
+  FILE* f = fopen( path, "rb" );
+  unmem( path );
+  if( !f )
+    return 0;
+  GLuint ret = 0;
+  u32 ilen = strlen( diskIdentity ), vlen = strlen( vertex ), flen = strlen( fragment );
+  shaderFileHeader h;
+  if( fread( &h, sizeof( h ), 1, f ) == 1 && !memcmp( h.magic, shaderFileMagic, 8 ) &&
+      h.identityLen == ilen && h.vertexLen == vlen && h.fragmentLen == flen && h.binaryLen ){
+    u32 textLen = ilen + vlen + flen;
+    char* text = mem( textLen, char );
+    u8* binary = mem( h.binaryLen, u8 );
+    // The sources are kept so a hash collision can't load the wrong program.
+    if( fread( text, 1, textLen, f ) == textLen &&
+        fread( binary, 1, h.binaryLen, f ) == h.binaryLen &&
+        !memcmp( text, diskIdentity, ilen ) && !memcmp( text + ilen, vertex, vlen ) &&
+        !memcmp( text + ilen + vlen, fragment, flen ) ){
+      ret = glCreateProgram();
+      glProgramBinary( ret, h.format, binary, h.binaryLen );
+      GLint status;
+      glGetProgramiv( ret, GL_LINK_STATUS, &status );
+      // Drivers reject binaries they no longer like, e.g. after an update
+      // that left the version string alone.
+      if( status != GL_TRUE ){
+        glDeleteProgram( ret );
+        ret = 0;
+      }
+    }
+    unmem( text );
+    unmem( binary );
+  }
+  fclose( f );
+  return ret;
+}
+void shaderCacheRetrievable( GLuint program ){
+  if( diskReady() )
+    glProgramParameteri( program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE );
+}
+void shaderCacheSave( const char* vertex, const char* fragment, GLuint program ){
+  if( !diskReady() )
+    return;
+  GLint len = 0;
+  glGetProgramiv( program, GL_PROGRAM_BINARY_LENGTH, &len );
+  if( len <= 0 )
+    return;
+  u8* binary = mem( len, u8 );
+  GLsizei got = 0;
+  GLenum format = 0;
+  glGetProgramBinary( program, len, &got, &format, binary );
+  if( got > 0 ){
+    shaderFileHeader h;
+    memcpy( h.magic, shaderFileMagic, 8 );
+    h.format = format;
+    h.identityLen = strlen( diskIdentity );
+    h.vertexLen = strlen( vertex );
+    h.fragmentLen = strlen( fragment );
+    h.binaryLen = got;
+    char* path = diskPath( vertex, fragment );
+    char* temp = printToString( "%s.tmp", path );
+    // Written aside and renamed, so another instance never reads half a file.
+    FILE* f = fopen( temp, "wb" );
+    if( f ){
+      bool ok = fwrite( &h, sizeof( h ), 1, f ) == 1 &&
+        fwrite( diskIdentity, 1, h.identityLen, f ) == h.identityLen &&
+        fwrite( vertex, 1, h.vertexLen, f ) == h.vertexLen &&
+        fwrite( fragment, 1, h.fragmentLen, f ) == h.fragmentLen &&
+        fwrite( binary, 1, h.binaryLen, f ) == h.binaryLen;
+      ok = !fclose( f ) && ok;
+      if( !ok || rename( temp, path ) )
+        remove( temp );
+    }
+    unmem( temp );
+    unmem( path );
+  }
+  unmem( binary );
+}
+static void diskClear( void ){
+  if( diskIdentity )
+    unmem( diskIdentity );
+  diskIdentity = NULL;
+  diskState = 0;
+}
+#else
+// WebGL has no program binaries.
+void shaderCacheDirectory( const char* dir ){}
+GLuint shaderCacheLoad( const char* vertex, const char* fragment ){
+  return 0;
+}
+void shaderCacheRetrievable( GLuint program ){}
+void shaderCacheSave( const char* vertex, const char* fragment, GLuint program ){}
+static void diskClear( void ){}
+#endif
@@ -0,0 +1,46 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright © 2025 Jon DuBois. Written with the assistance of GPT-4 et al.   //
+////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef SHADERCACHE_H_INCLUDED
+#define SHADERCACHE_H_INCLUDED
+
+// Linked compute programs kept by a hash of their vertex and fragment source,
+// so makeCompute skips the compiler for a shader it has built before, be it in
+// this program, an eval, or a program since deleted. Each entry counts the
+// computes using it. One in use is only shared with computes of the same
+// program and its evals, which see the same variables in its uniforms. Of the
+// entries no compute uses, the SHADER_CACHE_IDLE most recently used are kept.
+// Only touched on the render thread, so there is no locking.
+#define SHADER_CACHE_IDLE 128
+
+// Fills in the GL program and locations of c from a cached program built from
+// these sources, and takes a reference to it. owner is the program that holds
+// the variables. Returns false if there is none that can be used.
+bool shaderCacheFind( const char* vertex, const char* fragment, const void* owner,
+                      u32 numVars, compute* c );
+// Adds the program and locations of c, just linked from these sources, taking
+// a reference to it.
+void shaderCacheAdd( const char* vertex, const char* fragment, const void* owner,
+                     u32 numVars, const compute* c );
+// Drops a reference to program, which stays cached while there is room.
+void shaderCacheRelease( GLuint program );
+// Deletes every cached program no compute uses.
+void shaderCacheClear( void );
+
+// Linked programs can also be saved to a directory with glGetProgramBinary,
+// so the next run loads them rather than compiling. Files are named by a hash
+// of both sources and the GL vendor, renderer and version, and hold all of
+// those to check against. Off unless a directory is given, and always off in
+// WebGL, which has no program binaries.
+void shaderCacheDirectory( const char* dir );
+// Returns a program loaded from the binary saved for these sources, or 0 if
+// there is none or the driver rejects it.
+GLuint shaderCacheLoad( const char* vertex, const char* fragment );
+// Asks that the binary of program be retrievable; call before linking.
+void shaderCacheRetrievable( GLuint program );
+// Saves the binary of program, just linked from these sources.
+void shaderCacheSave( const char* vertex, const char* fragment, GLuint program );
+
+#endif //SHADERCACHE_H_INCLUDED
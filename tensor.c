@@ -38,8 +38,39 @@
 /*     t->ownsData = true; */
 /*   } */
 /* }; */
+// Frees data, a host payload of t, unless it is t's inline storage.
+static void unmemData( tensor* t, f32* data ){
+  if( data != t->inlineData )
+    poolUnmem( data );
+}
+// A pooled payload of count floats, not zeroed.
+static f32* newData( u64 count ){
+  return poolAlloc( count * sizeof( f32 ) );
+}
+// A pooled tensor, zeroed but for the inline payload.
+static tensor* newHeader( void ){
+  tensor* ret = poolAlloc( sizeof( tensor ) );
+  memset( ret, 0, offsetof( tensor, inlineData ) );
+  return ret;
+}
+bool tensorShared( const tensor* t ){
+  return t->shared && *t->shared > 1;
+}
+bool releaseData( tensor* t ){
+  if( !t->shared )
+    return t->ownsData;
+  bool last = !--*t->shared;
+  if( last )
+    poolUnmem( t->shared );
+  t->shared = NULL;
+  return last;
+}
+void keepTensor( tensor* t ){
+  if( !t->ownsData )
+    takeOwnership( t );
+}
 void takeOwnership( tensor* t ){
-  if( t->ownsData )
+  if( t->ownsData && !tensorShared( t ) )
     return;
 
   if( t->gpu == 2 )
@@ -136,6 +167,7 @@ void takeOwnership( tensor* t ){
     glBindFramebuffer( GL_FRAMEBUFFER, 0 );
     
     // Update tensor to own new resources
+    releaseData( t );
     t->tex.texture = newTex;
     t->tex.framebuffer = newFBO;
     t->ownsData = true;
@@ -144,23 +176,36 @@ void takeOwnership( tensor* t ){
     // CPU path - unchanged
     tensorEnsureContiguous( t );
     
-    if( t->ownsData )
+    if( t->ownsData && !tensorShared( t ) )
       return;
     
-    f32* newData = mem( t->size, f32 );
-    memcpy( newData, t->data + t->offset, t->size * sizeof( f32 ) );
+    f32* data = t->size <= TENSOR_INLINE ? t->inlineData : newData( t->size );
+    memcpy( data, t->data + t->offset, t->size * sizeof( f32 ) );
+    releaseData( t );
     t->offset = 0;
-    t->data = newData;
+    t->data = data;
     t->ownsData = true;
   }
 }
-// DANGER this sets owns data to false, therefore the underlying data MUST NOT
-// be destroyed BEFORE the copy while the programming is running. At exit
-// cleanup, it shouldn't matter the order of deallocation.
-tensor* copyTensor( const tensor* t ){
-  tensor* ret = mem( 1, tensor );
+// A copy of an owning tensor shares its payload, which is copied only when one
+// of them takes ownership to write it. A copy of a view is another view, and
+// the underlying data MUST NOT be destroyed before it.
+tensor* copyTensor( tensor* t ){
+  tensor* ret = poolAlloc( sizeof( tensor ) );
   memcpy( ret, t, sizeof( tensor ) );
-  ret->ownsData = false;
+  // An inline payload was copied with the header, so the copy owns its own.
+  if( !t->gpu && t->data == t->inlineData ){
+    ret->data = ret->inlineData;
+    return ret;
+  }
+  if( t->ownsData ){
+    if( !t->shared ){
+      t->shared = poolAlloc( sizeof( u32 ) );
+      *t->shared = 1;
+    }
+    ++*t->shared;
+    ret->shared = t->shared;
+  }
   return ret;
 }
 void tensorToHostMemory( tensor* t ){
@@ -200,7 +245,7 @@ void tensorToHostMemoryReally( tensor* t ){
   unmem( tempData );
 
   // Now extract logical tensor using offset/strides
-  f32* hostData = mem( t->size, f32 );
+  f32* hostData = newData( t->size );
   
   // Compute standard contiguous strides for output
   u32 std_strides[4] = {1, 1, 1, 1};
@@ -228,7 +273,7 @@ void tensorToHostMemoryReally( tensor* t ){
   
   unmem( texData );
 
-  if( t->ownsData ){
+  if( releaseData( t ) ){
     if( t->tex.texture ){
       glDeleteTextures( 1, &t->tex.texture );
       t->tex.texture = 0;
@@ -378,8 +423,8 @@ void tensorToGPUMemory( tensor* t ){
   glBindTexture( GL_TEXTURE_2D_ARRAY, 0 );
 
   unmem( paddedData );
-  if( t->ownsData ){
-    unmem( tdata );
+  if( releaseData( t ) ){
+    unmemData( t, tdata );
   }
 
   t->gpu = true;
@@ -387,7 +432,7 @@ void tensorToGPUMemory( tensor* t ){
 }
 // Warning! this takes ownership of data and will deallocate it.
 tensor* newTensor( u32 rank, const u32* shape, f32* data ){
-  tensor* ret = mem( 1, tensor );
+  tensor* ret = newHeader();
 
   // Initialize basic properties
   ret->rank = rank;
@@ -410,10 +455,33 @@ tensor* newTensor( u32 rank, const u32* shape, f32* data ){
 
   return ret;
 }
+tensor* newSmallTensor( u32 rank, const u32* shape, const f32* data ){
+  tensor* ret = newTensor( rank, shape, NULL );
+  if( ret->size > TENSOR_INLINE )
+    error( "Attempt to make a small tensor of %u elements.", ret->size );
+  ret->data = ret->inlineData;
+  memcpy( ret->inlineData, data, ret->size * sizeof( f32 ) );
+  return ret;
+}
+tensor* newTransientTensor( u32 rank, const u32* shape ){
+  tensor* ret = newTensor( rank, shape, NULL );
+  ret->data = arenaAlloc( ret->size * sizeof( f32 ) );
+  if( ret->data )
+    ret->ownsData = false;
+  else
+    ret->data = newData( ret->size );
+  return ret;
+}
+void tensorEndFrame( tensorStack* ts ){
+  for( u32 i = 0; i < ts->size; ++i )
+    if( !ts->stack[ i ]->gpu && arenaOwns( ts->stack[ i ]->data ) )
+      takeOwnership( ts->stack[ i ] );
+  arenaReset();
+}
 void deleteTensor( tensor* t ){
   if( t == NULL )
     return;
-  if( t->ownsData ){
+  if( releaseData( t ) ){
     if( t->gpu ){
       if( t->tex.texture ){
         glDeleteTextures( 1, &t->tex.texture );
@@ -428,10 +496,130 @@ void deleteTensor( tensor* t ){
         t->tex.framebuffer = 0;
       }
     } else {
-      unmem( t->data );
+      unmemData( t, t->data );
     }
   }
-  unmem( t );
+  poolUnmem( t );
+}
+// What finishCompute needs of a compute still building.
+typedef struct computeBuild{
+  char* vertex;
+  char* fragment;
+  // 0 until the driver is given the sources.
+  GLuint vertexShader;
+  GLuint fragmentShader;
+  u32 vheaderLineCount;
+  u32 vheaderIncPreambleLineCount;
+  u32 headerLineCount;
+  u32 headerIncPreambleLineCount;
+  // Set once finishCompute has returned an error, so prewarming skips it.
+  bool failed;
+} computeBuild;
+static char* copyShaderSource( const char* s ){
+  u32 len = strlen( s );
+  char* ret = mem( len + 1, char );
+  memcpy( ret, s, len + 1 );
+  return ret;
+}
+static void deleteBuild( compute* c ){
+  computeBuild* b = c->build;
+  // Shaders are no longer needed once the program is linked.
+  if( b->vertexShader ){
+    glDeleteShader( b->vertexShader );
+    glDeleteShader( b->fragmentShader );
+  }
+  unmem( b->vertex );
+  unmem( b->fragment );
+  unmem( b );
+  c->build = NULL;
+}
+// True if the driver compiles on threads of its own and can be asked whether
+// it is done. The first call gives it as many threads as it likes.
+static bool parallelCompile( void ){
+#ifndef __EMSCRIPTEN__
+  static s32 parallel = -1;
+  if( parallel < 0 ){
+    parallel = 1;
+    if( GLEW_KHR_parallel_shader_compile )
+      glMaxShaderCompilerThreadsKHR( 0xFFFFFFFF );
+    else if( GLEW_ARB_parallel_shader_compile )
+      glMaxShaderCompilerThreadsARB( 0xFFFFFFFF );
+    else
+      parallel = 0;
+  }
+  return parallel;
+#else
+  return false;
+#endif
+}
+// Hands the sources of c to the driver to compile and link without waiting
+// on either, so drivers that compile on threads of their own can get on with
+// the next compute meanwhile.
+static void startBuild( compute* c ){
+  computeBuild* b = c->build;
+  parallelCompile();
+  u64 compileStart = tracing ? traceNow() : 0;
+  b->vertexShader = glCreateShader( GL_VERTEX_SHADER );
+  const char* p = b->vertex;
+  glShaderSource( b->vertexShader, 1, &p, NULL );
+  glCompileShader( b->vertexShader );
+  b->fragmentShader = glCreateShader( GL_FRAGMENT_SHADER );
+  p = b->fragment;
+  glShaderSource( b->fragmentShader, 1, &p, NULL );
+  glCompileShader( b->fragmentShader );
+
+  c->program = glCreateProgram();
+  shaderCacheRetrievable( c->program );
+  glAttachShader( c->program, b->vertexShader );
+  glAttachShader( c->program, b->fragmentShader );
+  // Bind attribute locations (if any)
+  glBindAttribLocation( c->program, 0, "_a_position" );
+  glLinkProgram( c->program );
+  if( tracing )
+    traceComplete( "shader", compileStart, "compile %s:%u", c->filename, c->linenum );
+}
+// Sets every variable uniform of c to the current value, leaving c in use.
+static void loadUniforms( const program* prog, const compute* c ){
+  glUseProgram( c->program );
+  for( u32 i = 0; i < prog->numVars; ++i )
+    loadUniform( prog, c, i );
+}
+// Looks up the argument, output and variable uniform locations of ret, which
+// has been linked.
+static void findLocations( const program* prog, compute* ret, u32 argCount ){
+  char sname[ 12 ] = "_a_astrides";
+  char toname[ 12 ] = "_a_atoffset";
+  char dname[ 9 ] = "_a_adims";
+  char tname[ 8 ] = "_a_atex";
+  for( u32 i = 0; i < argCount; ++i ){
+    sname[ 3 ] = 'a' + i;
+    toname[ 3 ] = 'a' + i;
+    dname[ 3 ] = 'a' + i;
+    tname[ 3 ] = 'a' + i;
+    ret->argStridesLocation[ i ] = glGetUniformLocation( ret->program, sname );
+    ret->argToffsetLocation[ i ] = glGetUniformLocation( ret->program, toname );
+    ret->argDimsLocation[ i ] = glGetUniformLocation( ret->program, dname );
+    ret->argTexLocation[ i ] = glGetUniformLocation( ret->program, tname );
+  }
+
+  ret->dimsLocation = glGetUniformLocation( ret->program, "_a_dims" );
+  ret->stridesLocation = glGetUniformLocation( ret->program, "_a_strides" );
+
+  // Get uniforms locations from program.
+  ret->uniformLocs = mem( prog->numVars, GLuint );
+  for( u32 i = 0; i < prog->numVars; ++i ){
+    u32 varlen = strlen( prog->varNames[ i ] );
+    char* safeName = mem( varlen + 1, char );
+    memcpy( safeName, prog->varNames[ i ], varlen + 1 );
+    for( u32 i = 0; i < varlen; ++i )
+      if( safeName[ i ] == '.' )
+        safeName[ i ] = '_';
+    int rv = glGetUniformLocation( ret->program, safeName );
+    ret->uniformLocs[ i ] = rv;
+    //    if( rv == -1 )
+    //      error( "Error getting uniform location %s %s!", safeName, uniforms );
+    unmem( safeName );
+  }
 }
 char* makeCompute( const char* filename,
                    u32 linenum,
@@ -461,6 +649,9 @@ char* makeCompute( const char* filename,
   ret->retCount = retCount;
   ret->channels = channels;
   ret->reuse = reuse;
+  ret->filename = filename;
+  ret->linenum = linenum;
+  ret->commandnum = commandnum;
   const char* vertexShaderTemplate = "\
     #version 300 es\n\
     precision highp float;\n\
@@ -756,132 +947,205 @@ char* makeCompute( const char* filename,
   vheaderIncPreambleLineCount += 12;
   if( len < 0 || len >= bufsize - smallbufsize || flen < 0 || flen >= bufsize )
     error( "%s", "Shader source exceeds buffer size." );
-  
-  GLuint vertexShader = glCreateShader( GL_VERTEX_SHADER );
-  const char* p = vertexShaderSource;
-  glShaderSource( vertexShader, 1, &p, NULL );
-  glCompileShader( vertexShader );
 
-  // Check for vertex shader compilation errors
+  // The variables live in the program an eval extends.
+  const program* owner = prog;
+  while( owner->parent )
+    owner = owner->parent;
+  u64 cacheStart = tracing ? traceNow() : 0;
+  if( shaderCacheFind( vertexShaderSource, fragmentShaderSource, owner, prog->numVars, ret ) ){
+    if( tracing )
+      traceComplete( "shader", cacheStart, "cached %s:%u", filename, linenum );
+    unmem( vertexShaderSource );
+    unmem( fragmentShaderSource );
+    unmem( footerSource );
+    // The uniforms still hold whatever they were last set to.
+    loadUniforms( prog, ret );
+    *returnCompute = ret; return NULL;
+  }
+  // A copy of a compute not yet built needn't look on disk again; whichever
+  // of them runs first leaves its program in the cache for the other.
+  bool copy = false;
+  for( u32 i = 0; i < prog->numComputes && !copy; ++i ){
+    const compute* c = prog->computes[ i ];
+    copy = c->build && c->argCount == argCount && !strcmp( c->build->vertex, vertexShaderSource ) &&
+      !strcmp( c->build->fragment, fragmentShaderSource );
+  }
+  if( tracing )
+    cacheStart = traceNow();
+  ret->program = copy ? 0 : shaderCacheLoad( vertexShaderSource, fragmentShaderSource );
+  if( ret->program ){
+    if( tracing )
+      traceComplete( "shader", cacheStart, "binary %s:%u", filename, linenum );
+    unmem( footerSource );
+    findLocations( prog, ret, argCount );
+    loadUniforms( prog, ret );
+    shaderCacheAdd( vertexShaderSource, fragmentShaderSource, owner, prog->numVars, ret );
+    unmem( vertexShaderSource );
+    unmem( fragmentShaderSource );
+    *returnCompute = ret; return NULL;
+  }
+  unmem( footerSource );
+
+  computeBuild* build = mem( 1, computeBuild );
+  build->vertex = copyShaderSource( vertexShaderSource );
+  build->fragment = copyShaderSource( fragmentShaderSource );
+  unmem( vertexShaderSource );
+  unmem( fragmentShaderSource );
+  build->vheaderLineCount = vheaderLineCount;
+  build->vheaderIncPreambleLineCount = vheaderIncPreambleLineCount;
+  build->headerLineCount = headerLineCount;
+  build->headerIncPreambleLineCount = headerIncPreambleLineCount;
+  ret->build = build;
+  *returnCompute = ret; return NULL;
+}
+// Takes the program of c, not yet handed to the driver, from the shader
+// cache. True if it was there.
+static bool buildFromCache( const program* prog, compute* c ){
+  const program* owner = prog;
+  while( owner->parent )
+    owner = owner->parent;
+  if( !shaderCacheFind( c->build->vertex, c->build->fragment, owner, prog->numVars, c ) )
+    return false;
+  loadUniforms( prog, c );
+  deleteBuild( c );
+  return true;
+}
+// Another compute of prog built from the same sources that the driver has
+// been given but that is not yet finished, or NULL.
+static compute* startedCopy( const program* prog, const compute* c ){
+  for( u32 i = 0; i < prog->numComputes; ++i ){
+    compute* o = prog->computes[ i ];
+    if( o != c && o->build && o->build->vertexShader && !o->build->failed &&
+        o->argCount == c->argCount && !strcmp( o->build->vertex, c->build->vertex ) &&
+        !strcmp( o->build->fragment, c->build->fragment ) )
+      return o;
+  }
+  return NULL;
+}
+char* finishCompute( const program* prog, compute* c ){
+  computeBuild* b = c->build;
+  if( !b )
+    return NULL;
+  if( !b->vertexShader ){
+    // A copy the driver already has is waited on rather than built again.
+    compute* copy = startedCopy( prog, c );
+    if( copy ){
+      char* emsg = finishCompute( prog, copy );
+      if( emsg )
+        unmem( emsg );
+    }
+    if( buildFromCache( prog, c ) )
+      return NULL;
+    startBuild( c );
+  }
+
+  // Check for shader compilation errors, in the order the driver was given
+  // them, which waits on any compiler still at work.
+  static const u32 bufsize = 65536;
+  u64 waitStart = tracing ? traceNow() : 0;
   GLint status;
-  glGetShaderiv( vertexShader, GL_COMPILE_STATUS, &status );
+  glGetShaderiv( b->vertexShader, GL_COMPILE_STATUS, &status );
   if( status != GL_TRUE ){
-    static const u32 bufsize = 65536;
     char* emsg = mem( bufsize, char );
     char* log = mem( bufsize, char );
-    glGetShaderInfoLog( vertexShader, bufsize, NULL, log );
-    snprintf( emsg, bufsize, "%s:%u command %u:\nVertex shader compilation failed, error line numbers offset by %u for preamble and %u for main body:\n\n %s", filename, linenum, commandnum, vheaderLineCount, vheaderIncPreambleLineCount, log );
-    glDeleteShader( vertexShader );
+    glGetShaderInfoLog( b->vertexShader, bufsize, NULL, log );
+    snprintf( emsg, bufsize, "%s:%u command %u:\nVertex shader compilation failed, error line numbers offset by %u for preamble and %u for main body:\n\n %s", c->filename, c->linenum, c->commandnum, b->vheaderLineCount, b->vheaderIncPreambleLineCount, log );
     unmem( log );
-    unmem( vertexShaderSource );
-    unmem( fragmentShaderSource );
-    unmem( footerSource );
-    unmem( ret );
+    b->failed = true;
     return emsg;
   }
-
-  // Compile the fragment shader
-  GLuint fragmentShader = glCreateShader( GL_FRAGMENT_SHADER );
-  p = fragmentShaderSource;
-  glShaderSource( fragmentShader, 1, &p, NULL );
-  glCompileShader( fragmentShader );
-  
-
-  // Check for fragment shader compilation errors
-  glGetShaderiv( fragmentShader, GL_COMPILE_STATUS, &status );
+  glGetShaderiv( b->fragmentShader, GL_COMPILE_STATUS, &status );
   if( status != GL_TRUE ){
-    static const u32 bufsize = 65536;
     char* emsg = mem( bufsize, char );
     char* log = mem( bufsize, char );
-    glGetShaderInfoLog( fragmentShader, bufsize, NULL, log );
-    snprintf( emsg, bufsize, "%s:%u command %u:\nFragment shader compilation failed, error line numbers offset by %u for preamble and %u for main body:\n\n %s", filename, linenum, commandnum, headerLineCount, headerIncPreambleLineCount, log );
-    glDeleteShader( fragmentShader );
-    glDeleteShader( vertexShader );
+    glGetShaderInfoLog( b->fragmentShader, bufsize, NULL, log );
+    snprintf( emsg, bufsize, "%s:%u command %u:\nFragment shader compilation failed, error line numbers offset by %u for preamble and %u for main body:\n\n %s", c->filename, c->linenum, c->commandnum, b->headerLineCount, b->headerIncPreambleLineCount, log );
     unmem( log );
-    unmem( vertexShaderSource );
-    unmem( fragmentShaderSource );
-    unmem( footerSource );
-    unmem( ret );
+    b->failed = true;
     return emsg;
   }
-
-  unmem( vertexShaderSource );
-  unmem( fragmentShaderSource );
-  unmem( footerSource );
-
-  // Create the program and attach both shaders
-  ret->program = glCreateProgram();
-  glAttachShader( ret->program, vertexShader );
-  glAttachShader( ret->program, fragmentShader );
-
-  // Bind attribute locations (if any)
-  glBindAttribLocation( ret->program, 0, "_a_position" );
-
-  // Link the program
-  glLinkProgram( ret->program );
-
-  // Check for linking errors
-  glGetProgramiv( ret->program, GL_LINK_STATUS, &status );
+  glGetProgramiv( c->program, GL_LINK_STATUS, &status );
+  if( tracing )
+    traceComplete( "shader", waitStart, "link %s:%u", c->filename, c->linenum );
   if( status != GL_TRUE ){
-    static const u32 bufsize = 65536;
     char* emsg = mem( bufsize, char );
     char* log = mem( bufsize, char );
-    glGetProgramInfoLog( ret->program, sizeof( log ), NULL, log );
-    snprintf( emsg, bufsize, "Program linking failed: %s", log );
-    glDeleteProgram( ret->program );
-    glDeleteShader( vertexShader );
-    glDeleteShader( fragmentShader );
+    glGetProgramInfoLog( c->program, bufsize, NULL, log );
+    snprintf( emsg, bufsize, "%s:%u command %u:\nProgram linking failed: %s", c->filename, c->linenum, c->commandnum, log );
     unmem( log );
-    unmem( vertexShaderSource );
-    unmem( fragmentShaderSource );
-    unmem( footerSource );
-    unmem( ret );
-    return emsg;;
+    b->failed = true;
+    return emsg;
   }
 
-  // Get uniforms.
-  char sname[ 12 ] = "_a_astrides";
-  char toname[ 12 ] = "_a_atoffset";
-  char dname[ 9 ] = "_a_adims";
-  char tname[ 8 ] = "_a_atex";
-  for( u32 i = 0; i < argCount; ++i ){
-    sname[ 3 ] = 'a' + i;
-    toname[ 3 ] = 'a' + i;
-    dname[ 3 ] = 'a' + i;
-    tname[ 3 ] = 'a' + i;
-    ret->argStridesLocation[ i ] = glGetUniformLocation( ret->program, sname );
-    ret->argToffsetLocation[ i ] = glGetUniformLocation( ret->program, toname );
-    ret->argDimsLocation[ i ] = glGetUniformLocation( ret->program, dname );
-    ret->argTexLocation[ i ] = glGetUniformLocation( ret->program, tname );
+  const program* owner = prog;
+  while( owner->parent )
+    owner = owner->parent;
+  findLocations( prog, c, c->argCount );
+  // The variables may have been set since the program was made.
+  loadUniforms( prog, c );
+  shaderCacheSave( b->vertex, b->fragment, c->program );
+  shaderCacheAdd( b->vertex, b->fragment, owner, prog->numVars, c );
+  deleteBuild( c );
+  return NULL;
+}
+void prewarmComputes( const program* prog, f64 budget ){
+  u64 start = SDL_GetPerformanceCounter();
+  u64 end = start + budget * SDL_GetPerformanceFrequency() / 1000.0;
+  bool parallel = parallelCompile();
+  for( u32 i = 0; i < prog->numComputes && SDL_GetPerformanceCounter() < end; ++i ){
+    compute* c = prog->computes[ i ];
+    computeBuild* b = c->build;
+    if( !b || b->failed )
+      continue;
+    // With compiler threads, start what there is time for and finish what
+    // is done, rather than waiting on any.
+    if( !b->vertexShader ){
+      if( buildFromCache( prog, c ) || ( parallel && startedCopy( prog, c ) ) )
+        continue;
+      startBuild( c );
+      if( parallel )
+        continue;
+    }else if( parallel ){
+      GLint done = GL_FALSE;
+      glGetProgramiv( c->program, GL_COMPLETION_STATUS_KHR, &done );
+      if( done != GL_TRUE )
+        continue;
+    }
+    // Errors are left for the compute to report when it runs.
+    char* emsg = finishCompute( prog, c );
+    if( emsg )
+      unmem( emsg );
   }
-
-  ret->dimsLocation = glGetUniformLocation( ret->program, "_a_dims" );
-  ret->stridesLocation = glGetUniformLocation( ret->program, "_a_strides" );
-
-  // Get uniforms locations from program.
-  ret->uniformLocs = mem( prog->numVars, GLuint );
-  for( u32 i = 0; i < prog->numVars; ++i ){
-    u32 varlen = strlen( prog->varNames[ i ] );
-    char* safeName = mem( varlen + 1, char );
-    memcpy( safeName, prog->varNames[ i ], varlen + 1 );
-    for( u32 i = 0; i < varlen; ++i )
-      if( safeName[ i ] == '.' )
-        safeName[ i ] = '_';
-    int rv = glGetUniformLocation( ret->program, safeName );
-    ret->uniformLocs[ i ] = rv;
-    //    if( rv == -1 )
-    //      error( "Error getting uniform location %s %s!", safeName, uniforms );
-    unmem( safeName );
+}
+// Loads the current value of variable index into the uniform of compute c,
+// which must be in use.
+void loadUniform( const program* p, const compute* c, u32 index ){
+  const f32* v = p->varBlock + p->varOffsets[ index ];
+  switch( p->varSizes[ index ] ){
+  case 1:
+    glUniform1fv( c->uniformLocs[ index ], 1, v );
+    break;
+  case 2:
+    glUniform2fv( c->uniformLocs[ index ], 1, v );
+    break;
+  case 3:
+    glUniform3fv( c->uniformLocs[ index ], 1, v );
+    break;
+  case 4:
+    glUniform4fv( c->uniformLocs[ index ], 1, v );
+    break;
+  case 16:
+    glUniformMatrix4fv( c->uniformLocs[ index ], 1, GL_TRUE, v );
+    break;
   }
-  // Cleanup shaders (they're no longer needed once the program is linked)
-  glDeleteShader( vertexShader );
-  glDeleteShader( fragmentShader );
-
-  *returnCompute = ret; return NULL;
 }
 void deleteCompute( compute* i ){
-  glDeleteProgram( i->program );
-  unmem( i->uniformLocs );
+  if( i->build )
+    deleteBuild( i );
+  shaderCacheRelease( i->program );
+  if( i->uniformLocs )
+    unmem( i->uniformLocs );
   unmem( i );
 }
 char* newTensorsInitialized( program* p, tensorStack* ts, u32 rank, u32* shape, const compute* compute, u32 vertCount, tensor*** returns ){
@@ -897,7 +1161,7 @@ char* newTensorsInitialized( program* p, tensorStack* ts, u32 rank, u32* shape,
            compute->argCount,
            ts->size );
   tensor** rets = mem( compute->retCount, tensor* );
-  tensor* ret;
+  tensor* ret = NULL;
   for( u32 i = 0; i < compute->argCount; ++i ){
     tensor* cur = ts->stack[ ( ts->size - 1 ) - i ];
     tensorToGPUMemory( cur );
@@ -947,7 +1211,6 @@ char* newTensorsInitialized( program* p, tensorStack* ts, u32 rank, u32* shape,
       if( !t->ownsData ){
          unmem( rets ); 
          err( "%s", "Attempt to return on top of a non-owning texture." ); 
-        //takeOwnership( t );
       }
       if( ( t->gpu != 1 ) || ( t->tex.channels != compute->channels ) ){
         unmem( rets );
@@ -957,6 +1220,8 @@ char* newTensorsInitialized( program* p, tensorStack* ts, u32 rank, u32* shape,
         unmem( rets );
         err( "%s", "Attempt to return on top of a incompatible tensor (bad size)." );
       }
+      // Writing a texture another tensor still shares copies it first.
+      takeOwnership( t );
       ret = t;
     } else {
       u32 found = TENSOR_CACHE;
@@ -992,7 +1257,7 @@ char* newTensorsInitialized( program* p, tensorStack* ts, u32 rank, u32* shape,
           ret->strides[ i ] = 1;
         }
       } else {
-        ret = mem( 1, tensor );
+        ret = newHeader();
         ret->tex.channels = compute->channels;
         if( rank > 4 )
           err( "%s", "Rank exceeds maximum of 4." );
@@ -1137,10 +1402,14 @@ char* newTensorsInitialized( program* p, tensorStack* ts, u32 rank, u32* shape,
     glDisable( GL_BLEND );
   
   CHECK_GL_ERROR();
+  if( gpuProfiling )
+    gpuProfileBegin( compute->filename, compute->linenum, compute->commandnum );
   // Draw the quad
   if( !compute->reuse )
     glClear( GL_COLOR_BUFFER_BIT );
   glDrawArrays( GL_TRIANGLES, 0, vertCount );
+  if( gpuProfiling )
+    gpuProfileEnd();
   CHECK_GL_ERROR();
   
   for( u32 i = 0; i < compute->retCount; ++i )
@@ -1195,7 +1464,8 @@ void pop( tensorStack* ts ){
   if( !ts->size )
     return;
   --ts->size;
-  if( !ts->stack[ ts->size ]->gpu || !ts->stack[ ts->size ]->ownsData )
+  if( !ts->stack[ ts->size ]->gpu || !ts->stack[ ts->size ]->ownsData ||
+      tensorShared( ts->stack[ ts->size ] ) )
     deleteTensor( ts->stack[ ts->size ] );
   else {
     if( ts->cache[ TENSOR_CACHE - 1 ] )
@@ -1304,10 +1574,6 @@ char* tensorCatHelper( tensor* t, tensor* t2, u32 axis ){
   tensorToHostMemory( t );
   tensorToHostMemory( t2 );
 
-  // Ensure both tensors own their data
-  takeOwnership( t );
-  takeOwnership( t2 );
-
   // Check that shapes are compatible except along the concatenation axis
   u32 new_shape[ 4 ];
   for( u32 i = 0; i < t->rank; ++i ){
@@ -1331,7 +1597,7 @@ char* tensorCatHelper( tensor* t, tensor* t2, u32 axis ){
   size_t total_elements = size;
 
   // Allocate new data buffer
-  f32* new_data = mem( total_elements, f32 );
+  f32* new_data = newData( total_elements );
 
   // Initialize indices
   u32 indices[ 4 ] = { 0, 0, 0, 0 };
@@ -1378,8 +1644,8 @@ char* tensorCatHelper( tensor* t, tensor* t2, u32 axis ){
   }
 
   // Free old data
-  if( t->ownsData ){
-    unmem( t->data );
+  if( releaseData( t ) ){
+    unmemData( t, t->data );
   }
 
   // Update tensor t to be the concatenated tensor
@@ -1404,7 +1670,7 @@ tensor*  tensorMultiplyHelper( tensor* t1, tensor* t2 ){
   tensorToHostMemory( t1 );
   tensorToHostMemory( t2 );
   
-  tensor* ret = mem( 1, tensor );
+  tensor* ret = newHeader();
   ret->rank = 2;
   ret->shape[ 2 ] = ret->shape[ 3 ] = 1;
   ret->shape[ 0 ] = t2->shape[ 0 ];
@@ -1414,7 +1680,7 @@ tensor*  tensorMultiplyHelper( tensor* t1, tensor* t2 ){
     ret->strides[ i ] = i == ret->rank - 1 ? 1 : t1->shape[ 1 ];
   ret->ownsData = true;
   ret->gpu = false;
-  ret->data = mem( ret->size, f32 );
+  ret->data = newData( ret->size );
 
   for( u32 i = 0; i < ret->shape[ 0 ]; ++i )
     for( u32 j = 0; j < ret->shape[ 1 ]; ++j ){
@@ -1558,7 +1824,7 @@ Uint32 getPixel( SDL_Surface* surface, int x, int y ){
   }
 }
 tensor* tensorFromFile( const char* filename ){
-  FILE* file = fopen( filename, "rb" );
+  FILE* file = openFile( filename, "rb" );
   if( !file )
     error( "%s %s.", "Failed to open file in tensorFromFile: ", filename );
   if( fseek( file, 0, SEEK_END ) ){
@@ -1598,7 +1864,7 @@ tensor* tensorFromImage( const u8* buffer, u64 fileSize ){
     error( "Unable to load image: %s\n", stbi_failure_reason() );
   }
 
-  tensor* ret = mem( 1, tensor );
+  tensor* ret = newHeader();
   ret->size = w * h * 4;
     
   // Shape: [Width, Height, 4]
@@ -1646,7 +1912,7 @@ tensor* tensorFromImage( const u8* buffer, u64 fileSize ){
   return ret;
 }
 tensor* tensorFromImageFile( const char* filename ){
-  FILE* file = fopen( filename, "rb" );
+  FILE* file = openFile( filename, "rb" );
   if( !file )
     error( "%s %s.", "Failed to open file in tensorFromFile: ", filename );
   if( fseek( file, 0, SEEK_END ) ){
@@ -1675,7 +1941,7 @@ tensor* tensorFromImageFile( const char* filename ){
   return ret;
 }
 tensor* tensorFromString( const char* string ){
-  tensor* ret = mem( 1, tensor );
+  tensor* ret = newHeader();
   ret->ownsData = true;
   for( u32 i = 0; i < 4; ++i )
     ret->shape[ i ] = ret->strides[ i ] = 1;
@@ -1683,7 +1949,7 @@ tensor* tensorFromString( const char* string ){
   ret->shape[ 0 ] = size;
   ret->size = size;
   ret->rank = 1;
-  ret->data = mem( size, f32 );
+  ret->data = size <= TENSOR_INLINE ? ret->inlineData : newData( size );
   for( u32 i = 0; i < size; ++i )
     ret->data[ i ] = string[ i ];
   return ret;
@@ -1696,9 +1962,8 @@ char* tensorRepeatHelper( tensor* t, u32 count ){
   if( t->rank == 4 )
     err( "%s", "Cannot increase rank of a tensor with rank 4." );
 
-  // Ensure data is on CPU and owned
+  // Ensure data is on CPU
   tensorToHostMemory( t );
-  takeOwnership( t );
   if( !tensorIsContiguous( t ) )
     tensorEnsureContiguous( t );
 
@@ -1708,12 +1973,12 @@ char* tensorRepeatHelper( tensor* t, u32 count ){
 
   u32 new_rank = old_rank + 1;
   u32 new_size = old_size * count;
-  f32* new_data = mem( new_size, f32 );
+  f32* new_data = newData( new_size );
   for( u32 i = 0; i < count; i++ )
     memcpy(
            new_data + i * old_size, t->data + t->offset, old_size * sizeof( f32 ) );
-  if( t->ownsData && t->data )
-    unmem( t->data );
+  if( releaseData( t ) && t->data )
+    unmemData( t, t->data );
 
   t->data = new_data;
   t->offset = 0;
@@ -1775,7 +2040,7 @@ void tensorEnsureContiguous( tensor* t ){
     return;  // Already contiguous, nothing to do.
 
   
-  f32* newData = mem( t->size, f32 );
+  f32* contiguous = newData( t->size );
 
   u32 std_strides[ 4 ] = { 1, 1, 1, 1 };
   if( t->rank > 0 ){
@@ -1801,16 +2066,16 @@ void tensorEnsureContiguous( tensor* t ){
     }
 
     // Copy the element to the new data buffer.
-    newData[ i ] = t->data[ src_idx ];
+    contiguous[ i ] = t->data[ src_idx ];
   }
 
   // Free old data if owned.
-  if( t->ownsData ){
-    unmem( t->data );
+  if( releaseData( t ) ){
+    unmemData( t, t->data );
   }
 
   // Update tensor with new contiguous data.
-  t->data = newData;
+  t->data = contiguous;
   t->offset = 0;
   t->ownsData = true;
 
@@ -1979,7 +2244,7 @@ char* tensorToTextureArray( tensor* t, u32 channels ){
 
   // 5. Update Tensor State
   // We free the CPU data because we moved it to the GPU
-  if( t->ownsData ) unmem( dataBase );
+  if( releaseData( t ) ) unmemData( t, dataBase );
   
   t->gpu = true;
   t->ownsData = true;
@@ -2050,7 +2315,7 @@ char* tensorToTextureArrayOld( tensor* t, u32 channels ){
 
   // 5. Update Tensor State
   // We free the CPU data because we moved it to the GPU
-  if( t->ownsData ) unmem( dataBase );
+  if( releaseData( t ) ) unmemData( t, dataBase );
 
   t->gpu = true;
   t->ownsData = true;
@@ -2200,7 +2465,7 @@ void kettle(tensorStack* ts, u32 count, const char* filename) {
   int status = mz_compress(compressedData, &compressedLen, rawData, (mz_ulong)totalUncompressedSize);
   if (status != MZ_OK) error("Kettle: Compression failed with error %d", status);
 
-  FILE* f = fopen(filename, "wb");
+  FILE* f = openFile( filename, "wb" );
   if (!f) error("Kettle: Could not open %s for writing.", filename);
 
   // Write file container format: [UncompressedSize (u32)] [CompressedSize (u32)] [Data...]
@@ -2286,7 +2551,7 @@ void resetUnkettleState( unkettleState* s ){
   if( s->currentTensor && s->uploadingSubSlice ) { 
     // If we were halfway through a tensor, kill it
     if( s->currentTensor->tex.texture ) glDeleteTextures(1, &s->currentTensor->tex.texture);
-    unmem( s->currentTensor ); 
+    poolUnmem( s->currentTensor ); 
   }
   s->currentTensor = NULL;
   s->uploadingSubSlice = false;
@@ -2295,7 +2560,9 @@ void resetUnkettleState( unkettleState* s ){
   s->currentY = 0;
   s->currentHeight = 0;
 }
-char* unkettle( tensorStack* ts, const char* filename, f32* progress ){
+// The stage the last slice started in, for the tracer.
+static u32 unkettleSliceStage = UNKETTLE_START;
+static char* unkettleSlice( tensorStack* ts, const char* filename, f32* progress ){
   static unkettleState s = {0};
 
   const f32 W_READ   = 0.10f; 
@@ -2312,6 +2579,7 @@ char* unkettle( tensorStack* ts, const char* filename, f32* progress ){
   // (Identical to previous version. Copy/Paste logic for START, OPEN, and READ here)
   if( s.stage == UNKETTLE_DONE ) resetUnkettleState( &s );
   if( s.stage == UNKETTLE_START ) s.stage = UNKETTLE_OPEN;
+  unkettleSliceStage = s.stage;
 
   if( s.stage == UNKETTLE_OPEN ){
     // ... [Same File Open Logic] ...
@@ -2320,7 +2588,7 @@ char* unkettle( tensorStack* ts, const char* filename, f32* progress ){
     // Short version for context:
     if( filename == NULL ) err("NULL filename");
     s.filename = mem( strlen(filename)+1, char ); strcpy(s.filename, filename);
-    s.f = fopen( s.filename, "rb" );
+    s.f = openFile( s.filename, "rb" );
     fread( &s.uSize, 4, 1, s.f ); fread( &s.cSize, 4, 1, s.f );
     s.compressedData = mem( s.cSize, u8 );
     s.bytesRead = 0;
@@ -2468,7 +2736,7 @@ char* unkettle( tensorStack* ts, const char* filename, f32* progress ){
         KettleMeta meta;
         READ_MEM( &meta, sizeof( KettleMeta ) );
         s.tempMipmapped = meta.mipmapped;
-        tensor* t = mem( 1, tensor );
+        tensor* t = newHeader();
         t->rank = meta.rank;
         t->size = meta.size;
         memcpy( t->shape, meta.shape, sizeof(u32)*4 );
@@ -2696,10 +2964,20 @@ char* unkettle( tensorStack* ts, const char* filename, f32* progress ){
 
   return NULL;
 }
+char* unkettle( tensorStack* ts, const char* filename, f32* progress ){
+  static const char* stageNames[] = { "start", "open", "read", "unzip", "upload", "done" };
+  if( !tracing )
+    return unkettleSlice( ts, filename, progress );
+  u64 start = traceNow();
+  char* ret = unkettleSlice( ts, filename, progress );
+  traceComplete( "unkettle", start, "unkettle %s", stageNames[ unkettleSliceStage ] );
+  return ret;
+}
 tensor* textBufferView( u32 width, u32 height, u32 scrollUp ){
   u32 shape[ 2 ] = { height, width };
-  u32 totalCells = width * height;
-  f32* view = mem( totalCells, f32 ); 
+  tensor* ret = newTransientTensor( 2, shape );
+  f32* view = ret->data;
+  u32 totalCells = ret->size;
 
   // Initialize with spaces (32.0f)
   for( u32 i = 0; i < totalCells; ++i ){
@@ -2772,7 +3050,7 @@ tensor* textBufferView( u32 width, u32 height, u32 scrollUp ){
     bufIdx = lineStart - 1; 
   }
 
-  return newTensor( 2, shape, view );
+  return ret;
 }
 char* tensorIndexHelper(tensor* t, tensor* indices, u32 axis, tensor** result) {
   if (!t || !indices)
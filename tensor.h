@@ -8,6 +8,9 @@
 
 #define TENSOR_CACHE 24
 #define MAX_TENSOR_DISPLAY_SIZE 1024
+// Host payloads up to this many floats, enough for a mat4, are kept inline in
+// the tensor rather than in a separate allocation.
+#define TENSOR_INLINE 16
 
 typedef struct{
   u32 rank;              // Rank of the tensor (0 to 4)
@@ -32,6 +35,10 @@ typedef struct{
     } tex;
   };
   bool ownsData;
+  // The count of tensors owning this payload once a copy shares it, or NULL
+  // while only this one does. The last owner to let go frees the payload.
+  u32* shared;
+  f32 inlineData[ TENSOR_INLINE ]; // data points here for an inline payload.
 } tensor;
 
 typedef struct{
@@ -47,6 +54,13 @@ typedef struct{
   GLuint* uniformLocs;
   u32 channels;
   bool reuse;
+  // Source location of the compute command, owned by the program.
+  const char* filename;
+  u32 linenum;
+  u32 commandnum;
+  // The sources and shaders of a compute makeCompute has started but
+  // finishCompute has not yet finished, otherwise NULL.
+  struct computeBuild* build;
 } compute;
 
 typedef struct{
@@ -58,18 +72,43 @@ typedef struct{
 
 #include "program.h"
 
+// Gives t a payload of its own that is safe to write, copying it if it is a
+// view or shared.
 void takeOwnership( tensor* t );
-tensor* copyTensor( const tensor* t );
+// Gives t a payload that outlives whatever it views, sharing an owned one.
+void keepTensor( tensor* t );
+// Lets go of t's payload, true if t owned it alone and the caller should free it.
+bool releaseData( tensor* t );
+bool tensorShared( const tensor* t );
+tensor* copyTensor( tensor* t );
 void tensorToHostMemory( tensor* t );
 void tensorToGPUMemory( tensor* t );
 tensorStack* newStack( void );
 // Warning! this takes ownership of data and will deallocate it.
 tensor* newTensor( u32 rank, const u32* shape, f32* data );
+// Copies size floats from data into a new tensor's inline storage.
+tensor* newSmallTensor( u32 rank, const u32* shape, const f32* data );
+// A tensor with an uninitialized payload from the frame arena, see pool.h.
+tensor* newTransientTensor( u32 rank, const u32* shape );
+// Copies arena payloads still on the stack out of the arena and resets it.
+void tensorEndFrame( tensorStack* ts );
+// Makes a compute, taking its program from the shader cache if it can, or
+// else keeping its sources to be built by finishCompute the first time it
+// runs. Until then it cannot be dispatched.
 char* makeCompute( const char* filename, u32 linenum, u32 commandnum, 
                    const program* prog, const char* uniforms, const char* vglslpre, const char* glslpre,
                    const char* vglsl, const char* glsl, u32 argCount, u32 retCount, u32 channels,
                    bool reuse, compute** ret );
+// Builds the program of c if need be and waits for it. Returns any compile or
+// link error, naming the file and line of the compute command.
+char* finishCompute( const program* prog, compute* c );
+// Builds computes of prog that have not yet run for about budget
+// milliseconds. Failures are left for the computes to report when they run.
+void prewarmComputes( const program* prog, f64 budget );
 void deleteCompute( compute* i );
+// Loads the current value of variable index into the uniform of compute c,
+// which must be in use.
+void loadUniform( const program* p, const compute* c, u32 index );
 char* newTensorsInitialized( program* p, tensorStack* ts, u32 rank, u32* shape,
                              const compute* initializer, u32 vertCount, tensor*** rets );
 tensor* tensorFromFile( const char* fileName );
@@ -80,20 +119,25 @@ void deleteTensor( tensor* t );
 void deleteStack( tensorStack* ts );
 void push( tensorStack* ts, tensor* t );
 char* tensorIndex( tensorStack* ts );
+char* tensorIndexHelper( tensor* t, tensor* indices, u32 axis, tensor** result );
 char* tensorReshape( tensorStack* ts, u32 index, u32 newRank, u32* newShape );
 void tensorEnsureContiguous( tensor* t );
 char* tensorTransposeHelper( tensor* t, u32 axis1, u32 axis2 );
 char* tensorTranspose( tensorStack* ts, u32 index, u32 axis1, u32 axis2 );
+char* tensorReverseHelper( tensor* t, u32 axis );
 char* tensorReverse( tensorStack* ts, u32 index, u32 axis );
+char* tensorCatHelper( tensor* t, tensor* t2, u32 axis );
 char* tensorCat( tensorStack* ts, u32 index1, u32 index2, u32 axis );
 char* tensorSlice( tensorStack* ts, u32 index, u32 axis, s32 start, s32 end );
 char* tensorTakeFirst( tensorStack* ts, u32 index );
 char* tensorTakeLast( tensorStack* ts, u32 index );
+char* tensorRepeatHelper( tensor* t, u32 count );
 char* tensorRepeat( tensorStack* ts, u32 index, u32 count );
 void tensorEnclose( tensor* t );
 void tensorExtrude( tensor* t );
 void tensorUnextrude( tensor* t );
 // Multiplies matrices in host memory.
+tensor* tensorMultiplyHelper( tensor* t1, tensor* t2 );
 void tensorMultiply( tensorStack* ts );
 void pop( tensorStack* ts );
 // Functions for printing tensors. These put the tensor in cpu memory if not already there.
@@ -293,9 +293,13 @@ void resize_image(
 // Returns [0]=Vertices, [1]=Indices, [2]=Animation, [3]=TextureArray
 tensor** loadGltfCooked( const char* filename, u32* outCount ){
   f32 animCount;
+  if( tracing ){
+    traceBegin( "gltf", "load %s", filename );
+    traceBegin( "gltf", "read" );
+  }
   
   // 1. FILE I/O (Manual to avoid fopen issues in some emscripten setups)
-  FILE* file = fopen( filename, "rb" );
+  FILE* file = openFile( filename, "rb" );
   if( !file )
     error( "ATLAS: Could not open file: %s", filename );
   fseek( file, 0, SEEK_END );
@@ -306,6 +310,10 @@ tensor** loadGltfCooked( const char* filename, u32* outCount ){
   void* fileData = mem( fileSize, u8 );
   fread( fileData, 1, fileSize, file );
   fclose( file );
+  if( tracing ){
+    traceEnd();
+    traceBegin( "gltf", "parse" );
+  }
 
 
   
@@ -400,6 +408,10 @@ tensor** loadGltfCooked( const char* filename, u32* outCount ){
 
  
   // --- ANIMATION BAKING ---
+  if( tracing ){
+    traceEnd();
+    traceBegin( "gltf", "animations" );
+  }
   tensor* t_anim = NULL;
   // (Standard animation code from before)
 
@@ -466,6 +478,10 @@ tensor** loadGltfCooked( const char* filename, u32* outCount ){
   }
 
   // --- TEXTURE BAKING (THE ATLAS PACKER) ---
+  if( tracing ){
+    traceEnd();
+    traceBegin( "gltf", "textures" );
+  }
   tensor* t_tex = NULL;
   u32 num_mats = data->materials_count;
   if( num_mats == 0 )
@@ -657,6 +673,10 @@ tensor** loadGltfCooked( const char* filename, u32* outCount ){
   
   // --- MESH LOADING (Vertices & Indices) ---
   // (Standard Mesh code...)
+  if( tracing ){
+    traceEnd();
+    traceBegin( "gltf", "meshes" );
+  }
   u32 float_per_vert = 21;
   u32 total_verts = 0;
   u32 total_indices = 0;
@@ -1013,6 +1033,10 @@ tensor** loadGltfCooked( const char* filename, u32* outCount ){
   }
   cgltf_free( data );
   unmem( fileData );
+  if( tracing ){
+    traceEnd();
+    traceEnd();
+  }
 
   
   f32* tp = mem( 1, f32 );
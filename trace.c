@@ -0,0 +1,87 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright © 2025 Jon DuBois. Written with the assistance of GPT-4 et al.   //
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Atlas.h"
+
+bool tracing = false;
+
+static FILE* traceFile = NULL;
+static u64 traceBase = 0;
+static f64 traceScale = 0.0; // Ticks to microseconds.
+static u32 traceEvents = 0;
+static SDL_mutex* traceMutex = NULL;
+
+void traceStart( const char* filename ){
+  traceFile = fopen( filename, "w" );
+  if( !traceFile )
+    error( "Failed to open trace output file %s.", filename );
+  traceMutex = SDL_CreateMutex();
+  traceBase = SDL_GetPerformanceCounter();
+  traceScale = 1e6 / (f64)SDL_GetPerformanceFrequency();
+  traceEvents = 0;
+  fprintf( traceFile, "{\"traceEvents\":[" );
+  tracing = true;
+}
+
+void traceFinish( void ){
+  if( !traceFile )
+    return;
+  tracing = false;
+  fprintf( traceFile, "\n]}\n" );
+  fclose( traceFile );
+  traceFile = NULL;
+  SDL_DestroyMutex( traceMutex );
+  traceMutex = NULL;
+}
+
+u64 traceNow( void ){
+  return SDL_GetPerformanceCounter();
+}
+
+// Writes one event. name may be NULL for end events.
+static void traceEvent( char phase, const char* category, u64 start, u64 end,
+                        const char* name ){
+  if( !traceFile )
+    return;
+  SDL_LockMutex( traceMutex );
+  fprintf( traceFile,
+           "%s\n{\"ph\":\"%c\",\"pid\":1,\"tid\":%lu,\"ts\":%.3f",
+           traceEvents++ ? "," : "",
+           phase,
+           (unsigned long)SDL_ThreadID(),
+           ( start - traceBase ) * traceScale );
+  if( phase == 'X' )
+    fprintf( traceFile, ",\"dur\":%.3f", ( end - start ) * traceScale );
+  if( category )
+    fprintf( traceFile, ",\"cat\":\"%s\"", category );
+  if( name ){
+    fprintf( traceFile, ",\"name\":" );
+    benchWriteString( traceFile, name );
+  }
+  fprintf( traceFile, "}" );
+  SDL_UnlockMutex( traceMutex );
+}
+
+void traceBegin( const char* category, const char* format, ... ){
+  char name[ 256 ];
+  va_list args;
+  va_start( args, format );
+  vsnprintf( name, sizeof( name ), format, args );
+  va_end( args );
+  traceEvent( 'B', category, traceNow(), 0, name );
+}
+
+void traceEnd( void ){
+  traceEvent( 'E', NULL, traceNow(), 0, NULL );
+}
+
+void traceComplete( const char* category, u64 start, const char* format, ... ){
+  u64 end = traceNow();
+  char name[ 256 ];
+  va_list args;
+  va_start( args, format );
+  vsnprintf( name, sizeof( name ), format, args );
+  va_end( args );
+  traceEvent( 'X', category, start, end, name );
+}
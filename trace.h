@@ -0,0 +1,23 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright © 2025 Jon DuBois. Written with the assistance of GPT-4 et al.   //
+////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TRACE_H_INCLUDED
+#define TRACE_H_INCLUDED
+
+// Timeline tracer. When enabled with --trace FILE, events are written in the
+// Chrome trace event format, viewable in chrome://tracing or ui.perfetto.dev.
+// Events nest per thread, so every traceBegin needs a matching traceEnd.
+extern bool tracing;
+
+void traceStart( const char* filename );
+void traceFinish( void );
+// The current time, for traceComplete.
+u64 traceNow( void );
+void traceBegin( const char* category, const char* format, ... );
+void traceEnd( void );
+// An event that started at start and ends now, for code with many exits.
+void traceComplete( const char* category, u64 start, const char* format, ... );
+
+#endif //TRACE_H_INCLUDED
@@ -132,3 +132,15 @@ bool trieSearch( trieNode* root, const char* key, u32* value ){
 
   return false;
 }
+
+// Calls f on the value of every key in the trie below root.
+void trieVisit( trieNode* root, void ( *f )( u32* value, void* data ), void* data ){
+  for( int i = 0; i < 256; ++i ){
+    trieNode* node = root->nextParts[ i ];
+    if( !node )
+      continue;
+    if( node->value != (u32)-1 )
+      f( &node->value, data );
+    trieVisit( node, f, data );
+  }
+}
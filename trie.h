@@ -17,6 +17,7 @@ trieNode* newTrieNode( const char* part, u32 value );
 void deleteTrieNode( trieNode* node );
 void trieInsert( trieNode* root, const char* key, u32 value );
 bool trieSearch( trieNode* root, const char* key, u32* value );
+void trieVisit( trieNode* root, void ( *f )( u32* value, void* data ), void* data );
 
 #endif //TRIE_H_INCLUDED
 